@@ -7,13 +7,355 @@
 #include <mutex>
 #include <atomic>
 #include <iomanip>
+#include <deque>
+#include <unordered_map>
+#include <string_view>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+// ==================== PROTOCOLO COORDINADOR / WORKERS ====================
+// Cada mensaje es una cabecera fija {tipo, longitud} seguida de "longitud" bytes.
+// Los enteros viajan en el orden de bytes nativo: pensado para localhost o
+// nodos de la misma arquitectura.
+
+enum TipoMensaje : uint32_t {
+    MENSAJE_PATRONES  = 1,   // coordinador -> worker: lista de patrones
+    MENSAJE_SHARD     = 2,  // coordinador -> worker: id, bytes "propios" y bytes del shard (+ solapamiento)
+    MENSAJE_RESULTADO = 3,  // worker -> coordinador: id y conteos parciales por patrón
+    MENSAJE_FIN       = 4,  // coordinador -> worker: terminar
+    MENSAJE_HOLA      = 5   // worker -> coordinador: pid, al conectarse (identifica la conexión)
+};
+
+struct CabeceraMensaje {
+    uint32_t tipo;
+    uint32_t reservado;
+    uint64_t longitud;
+};
+
+static bool enviarTodo(int fd, const void* datos, size_t n) {
+    const char* p = static_cast<const char*>(datos);
+    while (n > 0) {
+        ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+static bool recibirTodo(int fd, void* datos, size_t n) {
+    char* p = static_cast<char*>(datos);
+    while (n > 0) {
+        ssize_t r = ::recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+// Envía cabecera + hasta dos bloques de payload (evita copiar el shard a un buffer intermedio)
+static bool enviarMensaje(int fd, uint32_t tipo, const void* a, size_t na,
+                          const void* b = nullptr, size_t nb = 0) {
+    CabeceraMensaje cab{tipo, 0, (uint64_t)(na + nb)};
+    if (!enviarTodo(fd, &cab, sizeof(cab))) return false;
+    if (na > 0 && !enviarTodo(fd, a, na)) return false;
+    if (nb > 0 && !enviarTodo(fd, b, nb)) return false;
+    return true;
+}
+
+static bool recibirMensaje(int fd, uint32_t& tipo, std::string& payload) {
+    CabeceraMensaje cab;
+    if (!recibirTodo(fd, &cab, sizeof(cab))) return false;
+    tipo = cab.tipo;
+    payload.resize(cab.longitud);
+    return cab.longitud == 0 || recibirTodo(fd, &payload[0], cab.longitud);
+}
+
+template <typename T>
+static void agregarPOD(std::string& buf, const T& v) {
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+static T leerPOD(const std::string& buf, size_t& off) {
+    T v{};
+    if (off + sizeof(T) <= buf.size()) std::memcpy(&v, buf.data() + off, sizeof(T));
+    off += sizeof(T);
+    return v;
+}
+
+// Endpoints: "unix:/ruta/al/socket" o "tcp:host:puerto"
+static int conectarEndpoint(const std::string& endpoint) {
+    if (endpoint.rfind("unix:", 0) == 0) {
+        std::string ruta = endpoint.substr(5);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, ruta.c_str(), sizeof(addr.sun_path) - 1);
+        if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { ::close(fd); return -1; }
+        return fd;
+    }
+    if (endpoint.rfind("tcp:", 0) == 0) {
+        std::string resto = endpoint.substr(4);
+        size_t dp = resto.rfind(':');
+        if (dp == std::string::npos) return -1;
+        std::string host = resto.substr(0, dp), puerto = resto.substr(dp + 1);
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), puerto.c_str(), &hints, &res) != 0) return -1;
+        int fd = -1;
+        for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        if (fd >= 0) {
+            int uno = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+        }
+        return fd;
+    }
+    return -1;
+}
+
+// Crea el socket de escucha del coordinador. Devuelve el fd y completa el endpoint
+// al que deben conectarse los workers.
+static int escucharEndpoint(bool usarTcp, std::string& endpoint) {
+    if (usarTcp) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        int uno = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;  // puerto efímero
+        if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 64) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(fd, (sockaddr*)&addr, &len);
+        endpoint = "tcp:127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+        return fd;
+    }
+    std::string ruta = "/tmp/pattern_search_" + std::to_string(getpid()) + ".sock";
+    ::unlink(ruta.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, ruta.c_str(), sizeof(addr.sun_path) - 1);
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 64) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    endpoint = "unix:" + ruta;
+    return fd;
+}
+
+// Cuenta las ocurrencias (solapadas) de cada patrón que *empiezan* en [0, propios).
+// Los bytes posteriores a "propios" son el solapamiento con el shard siguiente:
+// permiten encontrar coincidencias que cruzan el borde sin contarlas dos veces.
+static std::vector<uint64_t> contarEnShard(const char* datos, size_t n, size_t propios,
+                                           const std::vector<std::string>& patrones) {
+    std::vector<uint64_t> conteos(patrones.size(), 0);
+    std::string_view shard(datos, n);
+    for (size_t i = 0; i < patrones.size(); i++) {
+        size_t pos = 0;
+        while ((pos = shard.find(patrones[i], pos)) != std::string_view::npos && pos < propios) {
+            conteos[i]++;
+            pos++;
+        }
+    }
+    return conteos;
+}
+
+// Bucle principal de un proceso worker. Solo mantiene en memoria el shard actual.
+// "fallarTras" y "retardoMs" permiten simular un worker caído o lento.
+static int ejecutarWorker(const std::string& endpoint, int fallarTras, int retardoMs) {
+    int fd = -1;
+    for (int intento = 0; intento < 50 && fd < 0; intento++) {
+        fd = conectarEndpoint(endpoint);
+        if (fd < 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (fd < 0) {
+        std::cerr << "Worker " << getpid() << ": no se pudo conectar a " << endpoint << std::endl;
+        return 1;
+    }
+
+    uint32_t miPid = (uint32_t)getpid();
+    if (!enviarMensaje(fd, MENSAJE_HOLA, &miPid, sizeof(miPid))) {
+        ::close(fd);
+        return 1;
+    }
+
+    std::vector<std::string> patrones;
+    std::string payload;
+    uint32_t tipo;
+    int procesados = 0;
+
+    while (recibirMensaje(fd, tipo, payload)) {
+        if (tipo == MENSAJE_PATRONES) {
+            size_t off = 0;
+            uint32_t cant = leerPOD<uint32_t>(payload, off);
+            patrones.clear();
+            for (uint32_t i = 0; i < cant; i++) {
+                uint32_t len = leerPOD<uint32_t>(payload, off);
+                patrones.push_back(payload.substr(off, len));
+                off += len;
+            }
+        } else if (tipo == MENSAJE_SHARD) {
+            if (fallarTras >= 0 && procesados >= fallarTras) {
+                std::cerr << "Worker " << getpid() << ": fallo simulado" << std::endl;
+                _exit(2);
+            }
+            if (retardoMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(retardoMs));
+
+            size_t off = 0;
+            uint32_t id = leerPOD<uint32_t>(payload, off);
+            uint64_t propios = leerPOD<uint64_t>(payload, off);
+            std::vector<uint64_t> conteos = contarEnShard(payload.data() + off, payload.size() - off,
+                                                          (size_t)propios, patrones);
+            std::string resp;
+            agregarPOD(resp, id);
+            agregarPOD(resp, (uint32_t)conteos.size());
+            for (uint64_t c : conteos) agregarPOD(resp, c);
+            if (!enviarMensaje(fd, MENSAJE_RESULTADO, resp.data(), resp.size())) break;
+            procesados++;
+        } else if (tipo == MENSAJE_FIN) {
+            break;
+        }
+    }
+    ::close(fd);
+    return 0;
+}
+
+// ==================== ANÁLISIS DE N-GRAMAS FRECUENTES ====================
+// Hash polinomial que se extiende byte a byte: desde una posición i se obtienen
+// los hashes de todos los n-gramas [i, i+n) con n = 1..NGRAMA_MAX en una sola pasada.
+// La longitud se mezcla en el hash para que "ab" y "\0ab" no colisionen.
+
+const int NGRAMA_MIN = 3;
+const int NGRAMA_MAX = 16;
+const uint64_t BASE_HASH = 0x100000001b3ULL;
+
+static inline uint64_t mezclarLongitud(uint64_t h, int n) {
+    return h ^ ((uint64_t)n * 0x9e3779b97f4a7c15ULL);
+}
+
+// Count-min sketch por hilo: cada hilo escribe solo en el suyo (sin locks ni atómicos)
+// y al final se suman fila a fila.
+struct CountMinSketch {
+    static const int PROFUNDIDAD = 4;
+    int bitsAncho;
+    std::vector<uint32_t> tabla;  // PROFUNDIDAD filas de 2^bitsAncho contadores
+
+    explicit CountMinSketch(int bits) : bitsAncho(bits), tabla((size_t)PROFUNDIDAD << bits, 0) {}
+
+    inline size_t indice(int fila, uint64_t h) const {
+        static const uint64_t MULT[PROFUNDIDAD] = {
+            0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL};
+        return ((size_t)fila << bitsAncho) + (size_t)((h * MULT[fila]) >> (64 - bitsAncho));
+    }
+
+    // Incrementa y devuelve la estimación (mínimo de las filas)
+    inline uint32_t incrementar(uint64_t h) {
+        uint32_t est = std::numeric_limits<uint32_t>::max();
+        for (int f = 0; f < PROFUNDIDAD; f++) {
+            uint32_t v = ++tabla[indice(f, h)];
+            est = std::min(est, v);
+        }
+        return est;
+    }
+
+    inline uint32_t estimar(uint64_t h) const {
+        uint32_t est = std::numeric_limits<uint32_t>::max();
+        for (int f = 0; f < PROFUNDIDAD; f++) est = std::min(est, tabla[indice(f, h)]);
+        return est;
+    }
+};
+
+struct CandidatoNgrama {
+    size_t posicion;   // primera aparición vista (para recuperar el texto)
+    uint32_t estimado;
+};
+
+// Candidatos a top-K de un hilo para una longitud n. Solo admite n-gramas cuya
+// estimación supera el umbral; al crecer demasiado se poda y el umbral sube.
+struct CandidatosHilo {
+    std::unordered_map<uint64_t, CandidatoNgrama> mapa;
+    uint32_t umbral = 2;
+    size_t capacidad = 64;
+
+    inline void observar(uint64_t h, size_t pos, uint32_t est) {
+        if (est < umbral) return;
+        auto it = mapa.find(h);
+        if (it != mapa.end()) {
+            it->second.estimado = est;
+            return;
+        }
+        mapa.emplace(h, CandidatoNgrama{pos, est});
+        if (mapa.size() > 2 * capacidad) podar();
+    }
+
+    void podar() {
+        std::vector<uint32_t> ests;
+        ests.reserve(mapa.size());
+        for (const auto& kv : mapa) ests.push_back(kv.second.estimado);
+        std::nth_element(ests.begin(), ests.begin() + (capacidad - 1), ests.end(), std::greater<uint32_t>());
+        umbral = std::max(umbral, ests[capacidad - 1]);
+        for (auto it = mapa.begin(); it != mapa.end();) {
+            if (it->second.estimado < umbral) it = mapa.erase(it);
+            else ++it;
+        }
+    }
+};
+
+struct NgramaFrecuente {
+    std::string texto;
+    uint64_t exacto;
+    uint32_t estimado;
+};
 
 class PatternSearchComplete {
 private:
-    std::string texto;
+    std::string texto;      // se lee completo recién cuando un modo en memoria lo necesita
+    std::string rutaTexto;  // el modo distribuido lee los shards directamente del archivo
+    bool textoCargado = false;
     std::vector<std::string> patrones;
     std::mutex outputMutex;
 
+    // Configuración del modo distribuido
+    int numWorkers = 4;
+    bool usarTcp = false;
+    bool simularFallos = false;
+    int umbralLentoMs = 2000;  // mínimo antes de reasignar un shard "lento"
+
     // Función auxiliar para esperar input del usuario
     void esperarInput(const std::string& mensaje) {
         std::cout << "\n" << mensaje << std::endl;
@@ -25,22 +367,20 @@ private:
 public:
     bool cargarArchivos(const std::string& archivoTexto, const std::string& archivoPatrones) {
         // Cargar archivo de texto
+        rutaTexto = archivoTexto;
         std::ifstream fileTexto(archivoTexto, std::ios::binary);
         if (!fileTexto) {
             std::cerr << "Error: No se pudo abrir " << archivoTexto << std::endl;
             return false;
         }
         
-        // Leer todo el contenido del archivo
+        // Solo se mide: el contenido se lee en asegurarTexto(), así el modo
+        // distribuido funciona con archivos que no entran en memoria
         fileTexto.seekg(0, std::ios::end);
         size_t size = fileTexto.tellg();
-        fileTexto.seekg(0, std::ios::beg);
-        
-        texto.resize(size);
-        fileTexto.read(&texto[0], size);
         fileTexto.close();
         
-        std::cout << "Archivo de texto cargado: " << size << " caracteres" << std::endl;
+        std::cout << "Archivo de texto: " << size << " caracteres" << std::endl;
         
         // Cargar archivo de patrones
         std::ifstream filePatrones(archivoPatrones);
@@ -62,6 +402,19 @@ public:
         return true;
     }
     
+    // Lee todo el archivo de texto la primera vez que un modo en memoria lo usa
+    void asegurarTexto() {
+        if (textoCargado) return;
+        std::ifstream fileTexto(rutaTexto, std::ios::binary);
+        fileTexto.seekg(0, std::ios::end);
+        size_t size = fileTexto.tellg();
+        fileTexto.seekg(0, std::ios::beg);
+        texto.resize(size);
+        fileTexto.read(&texto[0], size);
+        textoCargado = true;
+        std::cout << "Archivo de texto cargado: " << size << " caracteres" << std::endl;
+    }
+    
     int contarOcurrencias(const std::string& patron) {
         int count = 0;
         size_t pos = 0;
@@ -79,6 +432,7 @@ public:
         std::cout << "Este método procesará cada patrón uno por uno en un solo hilo." << std::endl;
         
         esperarInput("¿Listo para ejecutar la búsqueda secuencial?");
+        asegurarTexto();
         
         std::vector<int> resultados(patrones.size());
         
@@ -126,6 +480,7 @@ public:
         std::cout << "Número de hilos que se usarán: " << patrones.size() << " (uno por patrón)" << std::endl;
         
         esperarInput("¿Listo para ejecutar la búsqueda multihilo?");
+        asegurarTexto();
         
         std::vector<std::atomic<int>> resultadosAtomicos(patrones.size());
         for (auto& resultado : resultadosAtomicos) {
@@ -165,6 +520,499 @@ public:
         return {resultados, tiempoSegundos};
     }
     
+    // Lanza un worker como proceso independiente (fork + exec del propio binario),
+    // de modo que no comparte la memoria del coordinador.
+    pid_t lanzarWorker(const std::string& endpoint, int fallarTras, int retardoMs) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::string f = std::to_string(fallarTras), r = std::to_string(retardoMs);
+            execl("/proc/self/exe", "pattern_search_complete", "--worker", endpoint.c_str(),
+                  "--fallar-tras", f.c_str(), "--retardo-ms", r.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        return pid;
+    }
+
+    std::pair<std::vector<int>, double> busquedaDistribuida() {
+        struct Shard {
+            size_t inicio, fin;        // bytes propios [inicio, fin)
+            bool hecho = false;
+            bool reasignado = false;   // ya se encoló una copia especulativa
+        };
+        struct Worker {
+            int fd = -1;
+            pid_t pid = -1;            // proceso lanzado; su conexión se identifica por MENSAJE_HOLA
+            bool vivo = false;
+            int shard = -1;            // shard en curso (-1 = ocioso)
+            std::chrono::steady_clock::time_point inicioShard;
+        };
+
+        std::cout << "\n=== BÚSQUEDA DISTRIBUIDA (COORDINADOR / WORKERS) ===" << std::endl;
+        std::cout << "El archivo se reparte por rangos de bytes entre " << numWorkers
+                  << " procesos worker conectados por " << (usarTcp ? "TCP (localhost)" : "sockets Unix")
+                  << "." << std::endl;
+
+        esperarInput("¿Listo para ejecutar la búsqueda distribuida?");
+
+        std::vector<int> resultados(patrones.size(), 0);
+        auto inicio = std::chrono::high_resolution_clock::now();
+
+        // El coordinador no carga el texto: cada shard (+ solapamiento) se lee del
+        // archivo por desplazamiento justo antes de enviarlo.
+        int fdTexto = ::open(rutaTexto.c_str(), O_RDONLY);
+        struct stat st{};
+        if (fdTexto < 0 || fstat(fdTexto, &st) < 0) {
+            std::cerr << "Error: no se pudo abrir " << rutaTexto << ": " << std::strerror(errno) << std::endl;
+            if (fdTexto >= 0) ::close(fdTexto);
+            return {resultados, 0.0};
+        }
+        const size_t tamTexto = (size_t)st.st_size;
+        std::string bufShard;
+        auto leerShard = [&](size_t desde, size_t hasta) -> bool {
+            bufShard.resize(hasta - desde);
+            size_t leidos = 0;
+            while (leidos < bufShard.size()) {
+                ssize_t r = ::pread(fdTexto, &bufShard[leidos], bufShard.size() - leidos, (off_t)(desde + leidos));
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) return false;
+                leidos += (size_t)r;
+            }
+            return true;
+        };
+
+        // Solapamiento: una coincidencia que empieza en el último byte propio puede
+        // extenderse hasta longitud-1 bytes dentro del shard siguiente.
+        size_t maxPatron = 1;
+        for (const auto& p : patrones) maxPatron = std::max(maxPatron, p.size());
+        const size_t solapamiento = maxPatron - 1;
+
+        // Varios shards por worker para poder balancear y reasignar sin perder mucho trabajo
+        size_t objetivo = std::max<size_t>(1, tamTexto / ((size_t)numWorkers * 4));
+        size_t tamShard = std::min<size_t>(std::max<size_t>(objetivo, 64 * 1024), 64u << 20);
+        std::vector<Shard> shards;
+        for (size_t b = 0; b < tamTexto; b += tamShard) {
+            shards.push_back({b, std::min(tamTexto, b + tamShard)});
+        }
+        std::deque<int> pendientes;
+        for (size_t s = 0; s < shards.size(); s++) pendientes.push_back((int)s);
+
+        std::string endpoint;
+        int fdEscucha = escucharEndpoint(usarTcp, endpoint);
+        if (fdEscucha < 0) {
+            std::cerr << "Error: no se pudo crear el socket del coordinador" << std::endl;
+            ::close(fdTexto);
+            return {resultados, 0.0};
+        }
+
+        std::vector<Worker> workers(numWorkers);
+        for (int w = 0; w < numWorkers; w++) {
+            // Con simulación: el worker 0 muere tras un shard, el 1 es lento
+            int fallar = (simularFallos && w == 0) ? 1 : -1;
+            int retardo = (simularFallos && w == 1 && numWorkers > 1) ? 2 * umbralLentoMs : 0;
+            workers[w].pid = lanzarWorker(endpoint, fallar, retardo);
+        }
+
+        // Aceptar conexiones (con plazo, por si algún worker no arranca). El orden de
+        // llegada no es el de lanzamiento: cada worker se presenta con su pid y así
+        // la conexión queda asociada a su proceso (y a su rol de fallo/lentitud).
+        int conectados = 0;
+        auto limite = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (conectados < numWorkers && std::chrono::steady_clock::now() < limite) {
+            pollfd pfd{fdEscucha, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0) continue;
+            int fd = accept(fdEscucha, nullptr, nullptr);
+            if (fd < 0) continue;
+            uint32_t tipo;
+            std::string hola;
+            pollfd pfdHola{fd, POLLIN, 0};
+            if (poll(&pfdHola, 1, 2000) <= 0 || !recibirMensaje(fd, tipo, hola) ||
+                tipo != MENSAJE_HOLA || hola.size() != sizeof(uint32_t)) {
+                ::close(fd);
+                continue;
+            }
+            size_t off = 0;
+            pid_t pid = (pid_t)leerPOD<uint32_t>(hola, off);
+            auto it = std::find_if(workers.begin(), workers.end(),
+                                   [&](const Worker& w) { return w.pid == pid && w.fd < 0; });
+            if (it == workers.end()) {
+                std::cerr << "Conexión de un proceso desconocido (pid " << pid << "): descartada" << std::endl;
+                ::close(fd);
+                continue;
+            }
+            it->fd = fd;
+            it->vivo = true;
+            conectados++;
+        }
+        ::close(fdEscucha);
+        if (!usarTcp) ::unlink(endpoint.substr(5).c_str());
+
+        std::string msgPatrones;
+        agregarPOD(msgPatrones, (uint32_t)patrones.size());
+        for (const auto& p : patrones) {
+            agregarPOD(msgPatrones, (uint32_t)p.size());
+            msgPatrones += p;
+        }
+        for (auto& w : workers) {
+            if (w.vivo && !enviarMensaje(w.fd, MENSAJE_PATRONES, msgPatrones.data(), msgPatrones.size())) {
+                w.vivo = false;
+            }
+        }
+
+        size_t completados = 0;
+        bool errorLectura = false;
+        double sumaMsShard = 0.0;
+        int reasignaciones = 0, caidos = 0;
+
+        auto marcarCaido = [&](Worker& w) {
+            if (!w.vivo) return;
+            w.vivo = false;
+            ::close(w.fd);
+            caidos++;
+            if (w.shard >= 0 && !shards[w.shard].hecho) {
+                pendientes.push_front(w.shard);
+                reasignaciones++;
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << "Worker " << (&w - workers.data()) << " caído: shard " << w.shard << " reasignado" << std::endl;
+            }
+            w.shard = -1;
+        };
+
+        auto enviarShard = [&](Worker& w, int s) {
+            const Shard& sh = shards[s];
+            size_t finConSolape = std::min(tamTexto, sh.fin + solapamiento);
+            std::string cab;
+            agregarPOD(cab, (uint32_t)s);
+            agregarPOD(cab, (uint64_t)(sh.fin - sh.inicio));
+            w.shard = s;
+            w.inicioShard = std::chrono::steady_clock::now();
+            if (!leerShard(sh.inicio, finConSolape)) {
+                errorLectura = true;
+                w.shard = -1;
+                return;
+            }
+            if (!enviarMensaje(w.fd, MENSAJE_SHARD, cab.data(), cab.size(), bufShard.data(), bufShard.size())) {
+                marcarCaido(w);
+            }
+        };
+
+        while (completados < shards.size() && !errorLectura) {
+            // Descartar shards ya resueltos (copias especulativas que llegaron tarde)
+            while (!pendientes.empty() && shards[pendientes.front()].hecho) pendientes.pop_front();
+
+            // Asignar trabajo a los workers ociosos
+            for (auto& w : workers) {
+                if (!w.vivo || w.shard >= 0) continue;
+                while (!pendientes.empty() && shards[pendientes.front()].hecho) pendientes.pop_front();
+                if (pendientes.empty()) break;
+                int s = pendientes.front();
+                pendientes.pop_front();
+                enviarShard(w, s);
+            }
+
+            std::vector<pollfd> pfds;
+            std::vector<int> idx;
+            for (int w = 0; w < numWorkers; w++) {
+                if (workers[w].vivo && workers[w].shard >= 0) {
+                    pfds.push_back({workers[w].fd, POLLIN, 0});
+                    idx.push_back(w);
+                }
+            }
+
+            if (pfds.empty()) {
+                bool hayVivos = std::any_of(workers.begin(), workers.end(),
+                                            [](const Worker& w) { return w.vivo; });
+                if (!hayVivos) {
+                    // Sin workers: el coordinador termina los shards restantes por sí mismo
+                    std::cout << "Sin workers disponibles: el coordinador procesa los shards restantes" << std::endl;
+                    for (size_t s = 0; s < shards.size(); s++) {
+                        if (shards[s].hecho) continue;
+                        size_t finConSolape = std::min(tamTexto, shards[s].fin + solapamiento);
+                        if (!leerShard(shards[s].inicio, finConSolape)) {
+                            errorLectura = true;
+                            break;
+                        }
+                        auto c = contarEnShard(bufShard.data(), bufShard.size(),
+                                               shards[s].fin - shards[s].inicio, patrones);
+                        for (size_t i = 0; i < c.size(); i++) resultados[i] += (int)c[i];
+                        shards[s].hecho = true;
+                        completados++;
+                    }
+                }
+                continue;
+            }
+
+            poll(pfds.data(), pfds.size(), 100);
+
+            for (size_t k = 0; k < pfds.size(); k++) {
+                Worker& w = workers[idx[k]];
+                if (!(pfds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+                uint32_t tipo;
+                std::string payload;
+                if (!recibirMensaje(w.fd, tipo, payload) || tipo != MENSAJE_RESULTADO) {
+                    marcarCaido(w);
+                    continue;
+                }
+                size_t off = 0;
+                uint32_t id = leerPOD<uint32_t>(payload, off);
+                uint32_t cant = leerPOD<uint32_t>(payload, off);
+                if (id < shards.size() && !shards[id].hecho && cant == patrones.size()) {
+                    for (uint32_t i = 0; i < cant; i++) resultados[i] += (int)leerPOD<uint64_t>(payload, off);
+                    shards[id].hecho = true;
+                    completados++;
+                    sumaMsShard += std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - w.inicioShard).count();
+                }
+                w.shard = -1;
+            }
+
+            // Workers lentos: si un shard supera el umbral se encola una copia
+            // especulativa; gana el primer resultado que llegue.
+            double mediaMs = completados > 0 ? sumaMsShard / completados : 0.0;
+            double umbral = std::max<double>(umbralLentoMs, 4.0 * mediaMs);
+            auto ahora = std::chrono::steady_clock::now();
+            for (auto& w : workers) {
+                if (!w.vivo || w.shard < 0) continue;
+                Shard& sh = shards[w.shard];
+                double enCurso = std::chrono::duration<double, std::milli>(ahora - w.inicioShard).count();
+                if (!sh.hecho && !sh.reasignado && enCurso > umbral) {
+                    sh.reasignado = true;
+                    pendientes.push_back(w.shard);
+                    reasignaciones++;
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cout << "Worker " << (&w - workers.data()) << " lento en shard " << w.shard
+                              << " (" << (int)enCurso << " ms): copia especulativa encolada" << std::endl;
+                }
+            }
+        }
+
+        for (auto& w : workers) {
+            if (w.vivo) {
+                enviarMensaje(w.fd, MENSAJE_FIN, nullptr, 0);
+                ::close(w.fd);
+            }
+        }
+        for (auto& w : workers) {
+            if (w.pid > 0) {
+                kill(w.pid, SIGTERM);  // un worker lento puede seguir ocupado con una copia descartada
+                waitpid(w.pid, nullptr, 0);
+            }
+        }
+
+        ::close(fdTexto);
+        if (errorLectura) {
+            std::cerr << "Error: no se pudo leer " << rutaTexto << " (búsqueda incompleta)" << std::endl;
+        }
+
+        auto fin = std::chrono::high_resolution_clock::now();
+        auto duracion = std::chrono::duration_cast<std::chrono::milliseconds>(fin - inicio);
+        double tiempoSegundos = duracion.count() / 1000.0;
+
+        std::cout << "\n✓ BÚSQUEDA DISTRIBUIDA COMPLETADA" << std::endl;
+        std::cout << "Shards: " << shards.size() << " de ~" << tamShard << " bytes (solapamiento "
+                  << solapamiento << " bytes)" << std::endl;
+        std::cout << "Workers conectados: " << conectados << "  caídos: " << caidos
+                  << "  reasignaciones: " << reasignaciones << std::endl;
+        std::cout << "Tiempo de ejecución distribuida: " << duracion.count() << " ms" << std::endl;
+        std::cout << "Tiempo de ejecución distribuida: " << std::fixed << std::setprecision(3)
+                  << tiempoSegundos << " segundos" << std::endl;
+
+        return {resultados, tiempoSegundos};
+    }
+
+    // Top-K n-gramas (n = 3..16) con pasadas paralelas sobre texto:
+    //  1) cada hilo recorre su rango y actualiza su count-min sketch;
+    //  2) se suman los sketches; cada hilo vuelve a recorrer su rango y elige
+    //     candidatos según la estimación *global*, y se unen los candidatos;
+    //  3) los mejores candidatos se recuentan de forma exacta (otra pasada paralela
+    //     que solo consulta una tabla pequeña).
+    // Podar con la estimación global (y no con la del sketch propio) hace que un
+    // n-grama frecuente pero repartido entre hilos no se descarte en todos ellos.
+    std::vector<std::vector<NgramaFrecuente>> analisisNgramas(int topK, int numHilos) {
+        const int numLongitudes = NGRAMA_MAX - NGRAMA_MIN + 1;
+        const int bitsAncho = 18;  // 4 x 2^18 contadores = 4 MiB por hilo
+        numHilos = std::max(1, numHilos);
+
+        std::cout << "\n=== ANÁLISIS DE N-GRAMAS FRECUENTES ===" << std::endl;
+        std::cout << "Top-" << topK << " n-gramas para n = " << NGRAMA_MIN << ".." << NGRAMA_MAX
+                  << " usando " << numHilos << " hilos" << std::endl;
+        asegurarTexto();
+
+        auto inicio = std::chrono::high_resolution_clock::now();
+        const size_t n = texto.size();
+        const unsigned char* datos = reinterpret_cast<const unsigned char*>(texto.data());
+
+        // ---- Fase 1: pasada paralela con un sketch por hilo ----
+        std::vector<CountMinSketch> sketches;
+        sketches.reserve(numHilos);
+        for (int t = 0; t < numHilos; t++) sketches.emplace_back(bitsAncho);
+
+        std::vector<std::thread> hilos;
+        for (int t = 0; t < numHilos; t++) {
+            hilos.emplace_back([&, t]() {
+                size_t b = n * t / numHilos, e = n * (t + 1) / numHilos;
+                CountMinSketch& cms = sketches[t];
+                for (size_t i = b; i < e; i++) {
+                    uint64_t h = 0;
+                    int maxLen = (int)std::min<size_t>(NGRAMA_MAX, n - i);
+                    for (int len = 1; len <= maxLen; len++) {
+                        h = h * BASE_HASH + (uint64_t)datos[i + len - 1] + 1;
+                        if (len < NGRAMA_MIN) continue;
+                        cms.incrementar(mezclarLongitud(h, len));
+                    }
+                }
+            });
+        }
+        for (auto& h : hilos) h.join();
+        hilos.clear();
+
+        // ---- Fase 2: sumar sketches (cada hilo suma una franja) ----
+        CountMinSketch& global = sketches[0];
+        for (int t = 0; t < numHilos; t++) {
+            hilos.emplace_back([&, t]() {
+                size_t total = global.tabla.size();
+                size_t b = total * t / numHilos, e = total * (t + 1) / numHilos;
+                for (int s = 1; s < numHilos; s++) {
+                    const uint32_t* src = sketches[s].tabla.data();
+                    uint32_t* dst = global.tabla.data();
+                    for (size_t i = b; i < e; i++) dst[i] += src[i];
+                }
+            });
+        }
+        for (auto& h : hilos) h.join();
+        hilos.clear();
+
+        // Candidatos por hilo contra el sketch global (solo lectura). Como la
+        // estimación es la misma en todos los hilos, lo que queda entre las
+        // 8K mejores de la unión sobrevive a la poda en cada hilo que lo vio.
+        std::vector<std::vector<CandidatosHilo>> candidatos(numHilos, std::vector<CandidatosHilo>(numLongitudes));
+        for (auto& porHilo : candidatos)
+            for (auto& c : porHilo) c.capacidad = std::max<size_t>(64, 8 * (size_t)topK);
+        for (int t = 0; t < numHilos; t++) {
+            hilos.emplace_back([&, t]() {
+                size_t b = n * t / numHilos, e = n * (t + 1) / numHilos;
+                auto& cand = candidatos[t];
+                for (size_t i = b; i < e; i++) {
+                    uint64_t h = 0;
+                    int maxLen = (int)std::min<size_t>(NGRAMA_MAX, n - i);
+                    for (int len = 1; len <= maxLen; len++) {
+                        h = h * BASE_HASH + (uint64_t)datos[i + len - 1] + 1;
+                        if (len < NGRAMA_MIN) continue;
+                        uint64_t hn = mezclarLongitud(h, len);
+                        cand[len - NGRAMA_MIN].observar(hn, i, global.estimar(hn));
+                    }
+                }
+            });
+        }
+        for (auto& h : hilos) h.join();
+        hilos.clear();
+
+        // Por longitud: unión de candidatos ordenada por estimación global; se
+        // recuentan 4*K para absorber la sobreestimación del sketch.
+        struct Seleccionado { uint64_t hash; size_t pos; uint32_t est; };
+        std::vector<std::vector<Seleccionado>> seleccion(numLongitudes);
+        std::unordered_map<uint64_t, std::pair<int, int>> aRecontar;  // hash -> (longitud idx, índice)
+        for (int l = 0; l < numLongitudes; l++) {
+            std::unordered_map<uint64_t, size_t> union_;
+            for (int t = 0; t < numHilos; t++) {
+                for (const auto& kv : candidatos[t][l].mapa) {
+                    auto it = union_.find(kv.first);
+                    if (it == union_.end() || kv.second.posicion < it->second) union_[kv.first] = kv.second.posicion;
+                }
+            }
+            auto& sel = seleccion[l];
+            for (const auto& kv : union_) sel.push_back({kv.first, kv.second, global.estimar(kv.first)});
+            size_t limite = std::min(sel.size(), (size_t)topK * 4);
+            std::partial_sort(sel.begin(), sel.begin() + limite, sel.end(),
+                              [](const Seleccionado& a, const Seleccionado& b) { return a.est > b.est; });
+            sel.resize(limite);
+            for (size_t k = 0; k < sel.size(); k++) aRecontar[sel[k].hash] = {l, (int)k};
+        }
+        candidatos.clear();
+        sketches.clear();
+
+        // ---- Fase 3: recuento exacto en paralelo (compara bytes para descartar colisiones) ----
+        std::vector<std::vector<std::vector<uint64_t>>> exactosHilo(numHilos);
+        for (int t = 0; t < numHilos; t++) {
+            exactosHilo[t].resize(numLongitudes);
+            for (int l = 0; l < numLongitudes; l++) exactosHilo[t][l].assign(seleccion[l].size(), 0);
+            hilos.emplace_back([&, t]() {
+                size_t b = n * t / numHilos, e = n * (t + 1) / numHilos;
+                auto& exactos = exactosHilo[t];
+                for (size_t i = b; i < e; i++) {
+                    uint64_t h = 0;
+                    int maxLen = (int)std::min<size_t>(NGRAMA_MAX, n - i);
+                    for (int len = 1; len <= maxLen; len++) {
+                        h = h * BASE_HASH + (uint64_t)datos[i + len - 1] + 1;
+                        if (len < NGRAMA_MIN) continue;
+                        auto it = aRecontar.find(mezclarLongitud(h, len));
+                        if (it == aRecontar.end()) continue;
+                        const Seleccionado& s = seleccion[it->second.first][it->second.second];
+                        if (it->second.first == len - NGRAMA_MIN &&
+                            std::memcmp(datos + i, datos + s.pos, len) == 0) {
+                            exactos[it->second.first][it->second.second]++;
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& h : hilos) h.join();
+
+        std::vector<std::vector<NgramaFrecuente>> resultado(numLongitudes);
+        for (int l = 0; l < numLongitudes; l++) {
+            for (size_t k = 0; k < seleccion[l].size(); k++) {
+                uint64_t exacto = 0;
+                for (int t = 0; t < numHilos; t++) exacto += exactosHilo[t][l][k];
+                resultado[l].push_back({texto.substr(seleccion[l][k].pos, l + NGRAMA_MIN), exacto,
+                                        seleccion[l][k].est});
+            }
+            std::sort(resultado[l].begin(), resultado[l].end(),
+                      [](const NgramaFrecuente& a, const NgramaFrecuente& b) { return a.exacto > b.exacto; });
+            if ((int)resultado[l].size() > topK) resultado[l].resize(topK);
+        }
+
+        auto fin = std::chrono::high_resolution_clock::now();
+        auto duracion = std::chrono::duration_cast<std::chrono::milliseconds>(fin - inicio);
+        std::cout << "\n✓ ANÁLISIS DE N-GRAMAS COMPLETADO" << std::endl;
+        std::cout << "Tiempo de análisis: " << duracion.count() << " ms" << std::endl;
+
+        return resultado;
+    }
+
+    void mostrarNgramas(const std::vector<std::vector<NgramaFrecuente>>& resultado) {
+        auto visible = [](const std::string& s) {
+            std::string r;
+            for (char c : s) {
+                if (c == '\n') r += "\\n";
+                else if (c == '\t') r += "\\t";
+                else if (c == '\r') r += "\\r";
+                else r += c;
+            }
+            return r;
+        };
+        for (size_t l = 0; l < resultado.size(); l++) {
+            std::cout << "\n--- n = " << (l + NGRAMA_MIN) << " ---" << std::endl;
+            for (size_t k = 0; k < resultado[l].size(); k++) {
+                const auto& g = resultado[l][k];
+                std::cout << std::setw(3) << (k + 1) << ". \"" << visible(g.texto) << "\"  "
+                          << g.exacto << " veces (sketch: " << g.estimado << ")" << std::endl;
+            }
+        }
+    }
+
+    void configurarDistribuido() {
+        std::cout << "Número de procesos worker: ";
+        std::cin >> numWorkers;
+        if (numWorkers < 1) numWorkers = 1;
+        char respuesta;
+        std::cout << "¿Usar TCP en localhost en lugar de sockets Unix? (s/n): ";
+        std::cin >> respuesta;
+        usarTcp = (respuesta == 's' || respuesta == 'S');
+        std::cout << "¿Simular un worker caído y uno lento? (s/n): ";
+        std::cin >> respuesta;
+        simularFallos = (respuesta == 's' || respuesta == 'S');
+    }
+
     void mostrarResultados(const std::vector<int>& resultados, const std::string& titulo) {
         std::cout << "\n=== " << titulo << " ===" << std::endl;
         for (size_t i = 0; i < resultados.size(); i++) {
@@ -214,7 +1062,9 @@ public:
         std::cout << "2. Ejecutar búsqueda multihilo" << std::endl;
         std::cout << "3. Ejecutar ambas y comparar" << std::endl;
         std::cout << "4. Salir" << std::endl;
-        std::cout << "Selecciona una opción (1-4): ";
+        std::cout << "5. Ejecutar búsqueda distribuida (coordinador/workers) y verificar" << std::endl;
+        std::cout << "6. Análisis de n-gramas frecuentes (top-K, n = 3..16)" << std::endl;
+        std::cout << "Selecciona una opción (1-6): ";
     }
     
     void ejecutarInteractivo() {
@@ -271,13 +1121,46 @@ public:
                 case 4:
                     std::cout << "Saliendo del programa..." << std::endl;
                     return;
+                case 5: {
+                    configurarDistribuido();
+                    auto [resDist, tiempoDist] = busquedaDistribuida();
+                    mostrarResultados(resDist, "RESULTADOS BÚSQUEDA DISTRIBUIDA");
+
+                    // Verificar contra la búsqueda secuencial (se ejecuta si aún no se hizo)
+                    if (!secuencialEjecutado) {
+                        auto [resSeq, tiempoSeq] = busquedaSecuencial();
+                        resultadosSecuencial = resSeq;
+                        tiempoSecuencial = tiempoSeq;
+                        secuencialEjecutado = true;
+                    }
+                    if (verificarResultados(resultadosSecuencial, resDist)) {
+                        std::cout << "\n✓ Verificación: la búsqueda distribuida coincide con la secuencial" << std::endl;
+                    } else {
+                        std::cout << "\n✗ Error: la búsqueda distribuida difiere de la secuencial" << std::endl;
+                    }
+                    if (tiempoDist > 0) {
+                        std::cout << "Speedup distribuido vs secuencial: " << std::fixed << std::setprecision(3)
+                                  << (tiempoSecuencial / tiempoDist) << "x" << std::endl;
+                    }
+                    break;
+                }
+                case 6: {
+                    int topK;
+                    std::cout << "¿Cuántos n-gramas por longitud (K)?: ";
+                    std::cin >> topK;
+                    if (topK < 1) topK = 10;
+                    int hw = (int)std::thread::hardware_concurrency();
+                    auto resultado = analisisNgramas(topK, hw > 0 ? hw : 4);
+                    mostrarNgramas(resultado);
+                    break;
+                }
                 default:
-                    std::cout << "Opción inválida. Por favor selecciona 1-4." << std::endl;
+                    std::cout << "Opción inválida. Por favor selecciona 1-6." << std::endl;
                     break;
             }
             
             // Si ambos métodos han sido ejecutados, mostrar comparación
-            if (secuencialEjecutado && multihiloEjecutado && opcion != 3) {
+            if (secuencialEjecutado && multihiloEjecutado && opcion != 3 && opcion != 5 && opcion != 6) {
                 std::cout << "\n¿Deseas ver la comparación de rendimiento? (s/n): ";
                 char respuesta;
                 std::cin >> respuesta;
@@ -292,7 +1175,20 @@ public:
     }
 };
 
-int main() {
+int main(int argc, char** argv) {
+    // Modo worker: lanzado por el coordinador (o a mano en otra máquina)
+    //   pattern_search_complete --worker unix:/tmp/x.sock | tcp:host:puerto
+    if (argc >= 3 && std::string(argv[1]) == "--worker") {
+        int fallarTras = -1, retardoMs = 0;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string opt = argv[i];
+            if (opt == "--fallar-tras") fallarTras = std::stoi(argv[i + 1]);
+            else if (opt == "--retardo-ms") retardoMs = std::stoi(argv[i + 1]);
+        }
+        return ejecutarWorker(argv[2], fallarTras, retardoMs);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
     PatternSearchComplete searcher;
     
     std::cout << "=== BÚSQUEDA DE PATRONES EN TEXTO ===" << std::endl;
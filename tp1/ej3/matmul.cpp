@@ -1,17 +1,166 @@
 // matmul.cpp
+// Compilar: g++ -std=c++17 -O3 -march=native -pthread matmul.cpp -o matmul
 #include <bits/stdc++.h>
 #include <thread>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
 using namespace std;
 
 using Clock = chrono::high_resolution_clock;
 using ms    = chrono::duration<double, std::milli>;
 
+// ----------------- PÁGINAS ENORMES -----------------
+// Los buffers de 2 MiB o más se piden con mmap alineado a 2 MiB:
+// - primero MAP_HUGETLB, si se pidieron páginas explícitas (reservadas con vm.nr_hugepages);
+// - si no, páginas transparentes (madvise MADV_HUGEPAGE);
+// - si nada de eso está disponible, páginas normales de 4 KiB.
+// Así, recorrer B por paneles toca una entrada de TLB cada 2 MiB en vez de cada 4 KiB.
+enum class HugePages { Off, Transparent, Explicit };
+static HugePages g_hugepages = HugePages::Transparent;
+static constexpr size_t kHugePageBytes = size_t(2) << 20;
+
+struct HugeRegion { size_t len; bool explicit_pages; };
+struct HugeRegistry {
+    mutex mtx;
+    unordered_map<void*, HugeRegion> regions;
+    size_t hugetlb_failures = 0;  // pedidos MAP_HUGETLB que cayeron a THP
+};
+// Nunca se destruye: los buffers thread_local de los hilos del pool se liberan
+// al salir, después de los destructores estáticos.
+static HugeRegistry& huge_registry() { static HugeRegistry* r = new HugeRegistry; return *r; }
+
+static void* huge_alloc(size_t bytes) {
+    const size_t len = (bytes + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+    HugeRegistry& reg = huge_registry();
+    if (g_hugepages == HugePages::Explicit) {
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        lock_guard<mutex> lk(reg.mtx);
+        if (p != MAP_FAILED) {
+            reg.regions[p] = {len, true};
+            return p;
+        }
+        ++reg.hugetlb_failures;
+    }
+    // Reserva con 2 MiB de margen y recorta para que el inicio quede alineado
+    char* raw = (char*)mmap(nullptr, len + kHugePageBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == (char*)MAP_FAILED) return nullptr;
+    char* p = (char*)(((uintptr_t)raw + kHugePageBytes - 1) & ~(uintptr_t)(kHugePageBytes - 1));
+    if (p > raw) munmap(raw, p - raw);
+    const size_t tail = (size_t)((raw + len + kHugePageBytes) - (p + len));
+    if (tail) munmap(p + len, tail);
+    madvise(p, len, MADV_HUGEPAGE);
+    lock_guard<mutex> lk(reg.mtx);
+    reg.regions[p] = {len, false};
+    return p;
+}
+
+// Libera p si vino de huge_alloc; false si es una reserva común
+static bool huge_free(void* p) {
+    HugeRegistry& reg = huge_registry();
+    lock_guard<mutex> lk(reg.mtx);
+    auto it = reg.regions.find(p);
+    if (it == reg.regions.end()) return false;
+    munmap(p, it->second.len);
+    reg.regions.erase(it);
+    return true;
+}
+
+struct HugePageReport {
+    size_t big_bytes = 0;        // bytes en buffers grandes vivos
+    size_t explicit_pages = 0;   // páginas MAP_HUGETLB
+    size_t transparent_pages = 0;// páginas THP efectivamente asignadas (smaps)
+    size_t hugetlb_failures = 0;
+};
+
+// Cuenta las páginas enormes que respaldan hoy los buffers grandes. Las THP se
+// leen de /proc/self/smaps (AnonHugePages), así que sólo cuentan las páginas ya tocadas.
+static HugePageReport huge_page_report() {
+    HugePageReport r;
+    vector<pair<uintptr_t, uintptr_t>> thp;
+    {
+        HugeRegistry& reg = huge_registry();
+        lock_guard<mutex> lk(reg.mtx);
+        r.hugetlb_failures = reg.hugetlb_failures;
+        for (auto& [p, reg_info] : reg.regions) {
+            r.big_bytes += reg_info.len;
+            if (reg_info.explicit_pages) r.explicit_pages += reg_info.len / kHugePageBytes;
+            else thp.push_back({(uintptr_t)p, (uintptr_t)p + reg_info.len});
+        }
+    }
+    ifstream in("/proc/self/smaps");
+    string line;
+    bool inside = false;
+    while (getline(in, line)) {
+        uintptr_t lo, hi;
+        if (sscanf(line.c_str(), "%lx-%lx ", &lo, &hi) == 2 && line.find(':') > line.find(' ')) {
+            inside = any_of(thp.begin(), thp.end(), [&](auto& t) { return lo < t.second && t.first < hi; });
+        } else if (inside && line.rfind("AnonHugePages:", 0) == 0) {
+            r.transparent_pages += stoull(line.substr(14)) * 1024 / kHugePageBytes;
+        }
+    }
+    return r;
+}
+
+static void print_huge_page_report() {
+    const HugePageReport r = huge_page_report();
+    const char* mode = g_hugepages == HugePages::Off ? "no" : g_hugepages == HugePages::Explicit ? "explicitas" : "thp";
+    cout << "Páginas enormes (" << mode << "): " << r.explicit_pages << " explícitas + " << r.transparent_pages
+         << " transparentes de 2 MiB, sobre " << r.big_bytes / kHugePageBytes << " posibles";
+    if (r.hugetlb_failures) cout << " (" << r.hugetlb_failures << " pedidos MAP_HUGETLB sin páginas reservadas)";
+    cout << "\n";
+}
+
+// Asignador alineado a línea de caché que no inicializa los elementos
+// (evita el memset implícito de vector<T>(n) en los buffers de empaquetado).
+// Los buffers grandes van a páginas enormes (huge_alloc) cuando están habilitadas.
+template <class T>
+struct AlignedAllocator {
+    using value_type = T;
+    static constexpr size_t ALIGN = 64;
+    AlignedAllocator() = default;
+    template <class U> AlignedAllocator(const AlignedAllocator<U>&) {}
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + ALIGN - 1) / ALIGN * ALIGN;
+        void* p = nullptr;
+        if (g_hugepages != HugePages::Off && bytes >= kHugePageBytes) p = huge_alloc(bytes);
+        if (!p) p = aligned_alloc(ALIGN, max(bytes, ALIGN));
+        if (!p) throw bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t n) {
+        if (n * sizeof(T) >= kHugePageBytes && huge_free(p)) return;
+        free(p);
+    }
+    template <class U> void construct(U* p) { ::new ((void*)p) U; }
+    template <class U, class... Args> void construct(U* p, Args&&... args) {
+        ::new ((void*)p) U(std::forward<Args>(args)...);
+    }
+    template <class U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+template <class T> using avec = vector<T, AlignedAllocator<T>>;
+
+// Matrices densas fila-mayor. Sin inicialización implícita: las páginas se tocan
+// por primera vez en first_touch_fill, desde el hilo que luego las usa.
+using Matrix = avec<float>;
+
 struct Corners { float tl, tr, bl, br; };
 
-Corners corners_of(const vector<float>& M, int N) {
-    return { M[0], M[N-1], M[(size_t)(N-1)*N], M[(size_t)(N-1)*N + (N-1)] };
+Corners corners_of(const Matrix& M, int rows, int cols) {
+    return { M[0], M[cols-1], M[(size_t)(rows-1)*cols], M[(size_t)(rows-1)*cols + (cols-1)] };
 }
 
+Corners corners_of(const Matrix& M, int N) { return corners_of(M, N, N); }
+
 void print_corners(const string& name, const Corners& c) {
     cout << fixed << setprecision(6);
     cout << name << " esquinas => "
@@ -19,18 +168,19 @@ void print_corners(const string& name, const Corners& c) {
          << "  BL=" << c.bl << "  BR=" << c.br << "\n";
 }
 
-double matmul_serial_sum(vector<float>& C,
-                         const vector<float>& A,
-                         const vector<float>& B,
-                         int N)
+// C (M x N) = A (M x K) * B (K x N)
+double matmul_serial_sum(Matrix& C,
+                         const Matrix& A,
+                         const Matrix& B,
+                         int M, int K, int N)
 {
     fill(C.begin(), C.end(), 0.0f);
     double total = 0.0;
 
-    for (int i = 0; i < N; ++i) {
+    for (int i = 0; i < M; ++i) {
         float* __restrict c_row = C.data() + (size_t)i * N;
-        for (int k = 0; k < N; ++k) {
-            const float a = A[(size_t)i * N + k];
+        for (int k = 0; k < K; ++k) {
+            const float a = A[(size_t)i * K + k];
             const float* __restrict b_row = B.data() + (size_t)k * N;
             for (int j = 0; j < N; ++j) c_row[j] += a * b_row[j];
         }
@@ -39,113 +189,4665 @@ double matmul_serial_sum(vector<float>& C,
     return total;
 }
 
-void worker_block(const vector<float>& A, const vector<float>& B,
-                  vector<float>& C, int N, int i0, int i1, double& partial_sum)
+// ----------------- GEMM POR BLOQUES (paneles A/B empaquetados) -----------------
+// Esquema de lazos tipo GotoBLAS:
+//   jc (NC columnas, panel de B en L3) -> pc (KC, panel de B empaquetado)
+//   -> ic (MC filas, panel de A en L2) -> jr/ir (micro-tile MR x NR, B en L1)
+// Los paneles se copian a buffers contiguos y alineados en el orden exacto en
+// que los lee el micro-kernel: cada línea de caché cargada se reutiliza MC/MR
+// (B) o NC/NR (A) veces en lugar de una sola.
+
+struct BlockParams {
+    int MC = 144;   // filas de A por panel (múltiplo de MR)
+    int KC = 256;   // profundidad del panel
+    int NC = 4096;  // columnas de B por panel (múltiplo de NR)
+};
+
+
+// ----------------- MICRO-KERNELS (despacho en tiempo de ejecución) -----------------
+// Cada micro-kernel calcula un tile MR x NR de C a partir de un micro-panel de A
+// (kc x MR) y uno de B (kc x NR) empaquetados; el tile entero vive en registros
+// durante todo el lazo k y C se toca una sola vez al final. Los paneles vienen
+// rellenados con ceros, así que el kernel siempre calcula el tile completo y en
+// los bordes (mr < MR o nr < NR) solo escribe la parte válida.
+
+// Epílogo opcional aplicado mientras el tile todavía está en registros (o en el
+// buffer de L1 al que se vuelcan): y = act(scale * (AB [+ C]) + bias), luego
+// reducciones por fila / columna / total de y, y recién ahí la escritura en C
+// (que puede omitirse si sólo interesan las reducciones). Los punteros se
+// indexan relativos al origen del C que recibe gemm_blocked.
+enum class Activation { None, ReLU, GELU };
+
+struct Epilogue {
+    float scale = 1.0f;
+    const float* bias_col = nullptr;  // bias_col[j], uno por columna (típico de una capa densa)
+    const float* bias_row = nullptr;  // bias_row[i], uno por fila
+    Activation act = Activation::None;
+    double* row_sums = nullptr;       // += sumatoria de cada fila de y (atómico)
+    double* col_sums = nullptr;       // += sumatoria de cada columna de y (atómico)
+    double* total = nullptr;          // += sumatoria de y (atómico)
+    bool store_c = true;              // false: C nunca se escribe
+};
+
+static inline void atomic_add(double* target, double v) {
+    double cur;
+    __atomic_load(target, &cur, __ATOMIC_RELAXED);
+    double next;
+    do { next = cur + v; }
+    while (!__atomic_compare_exchange(target, &cur, &next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static inline float gelu(float x) {
+    return 0.5f * x * (1.0f + tanhf(0.7978845608f * (x + 0.044715f * x * x * x)));
+}
+
+using MicroKernelFn = void (*)(int kc, const float* __restrict Ap, const float* __restrict Bp,
+                               float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate,
+                               const Epilogue* ep, int row0, int col0);
+
+struct MicroKernel {
+    const char* name;
+    int MR, NR;
+    MicroKernelFn fn;
+};
+
+// Escribe la parte válida [0:mr, 0:nr] de un tile calculado en acc (paso lda).
+template <class T>
+static inline void store_tile(const T* acc, int lda, T* C, ptrdiff_t ldc,
+                              int mr, int nr, bool accumulate)
 {
-    double local_sum = 0.0;
-    for (int i = i0; i < i1; ++i) {
-        float* __restrict c_row = C.data() + (size_t)i * N;
-        for (int j = 0; j < N; ++j) c_row[j] = 0.0f;
+    for (int i = 0; i < mr; ++i) {
+        T* c = C + (ptrdiff_t)i * ldc;
+        const T* a = acc + (ptrdiff_t)i * lda;
+        if (accumulate) for (int j = 0; j < nr; ++j) c[j] += a[j];
+        else            for (int j = 0; j < nr; ++j) c[j]  = a[j];
+    }
+}
 
-        for (int k = 0; k < N; ++k) {
-            const float a = A[(size_t)i * N + k];
-            const float* __restrict b_row = B.data() + (size_t)k * N;
-            for (int j = 0; j < N; ++j) c_row[j] += a * b_row[j];
+// Igual que store_tile pero aplicando el epílogo; el tile (mr x nr, nr <= 32)
+// está en acc, así que C se lee sólo si accumulate y se escribe sólo si store_c.
+static inline void store_tile_epilogue(const float* acc, int lda, float* C, ptrdiff_t ldc,
+                                       int mr, int nr, bool accumulate,
+                                       const Epilogue& ep, int row0, int col0)
+{
+    float col_part[32] = {};
+    double tile_total = 0.0;
+    for (int i = 0; i < mr; ++i) {
+        float* c = C + (ptrdiff_t)i * ldc;
+        const float* a = acc + (ptrdiff_t)i * lda;
+        const float rb = ep.bias_row ? ep.bias_row[row0 + i] : 0.0f;
+        float y[32];
+        for (int j = 0; j < nr; ++j) y[j] = (accumulate ? a[j] + c[j] : a[j]) * ep.scale + rb;
+        if (ep.bias_col) for (int j = 0; j < nr; ++j) y[j] += ep.bias_col[col0 + j];
+        if (ep.act == Activation::ReLU)      for (int j = 0; j < nr; ++j) y[j] = max(y[j], 0.0f);
+        else if (ep.act == Activation::GELU) for (int j = 0; j < nr; ++j) y[j] = gelu(y[j]);
+        if (ep.store_c) for (int j = 0; j < nr; ++j) c[j] = y[j];
+        float row_part = 0.0f;
+        for (int j = 0; j < nr; ++j) { row_part += y[j]; col_part[j] += y[j]; }
+        if (ep.row_sums) atomic_add(ep.row_sums + row0 + i, row_part);
+        tile_total += row_part;
+    }
+    if (ep.col_sums) for (int j = 0; j < nr; ++j) atomic_add(ep.col_sums + col0 + j, col_part[j]);
+    if (ep.total) atomic_add(ep.total, tile_total);
+}
+
+// Versión portable: el compilador la vectoriza con el ISA de compilación.
+template <int MR_, int NR_>
+static void micro_kernel_generic(int kc, const float* __restrict Ap, const float* __restrict Bp,
+                                 float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate,
+                                 const Epilogue* ep, int row0, int col0)
+{
+    float acc[MR_][NR_] = {};
+    for (int p = 0; p < kc; ++p) {
+        const float* a = Ap + p * MR_;
+        const float* b = Bp + p * NR_;
+#pragma GCC unroll 8
+        for (int i = 0; i < MR_; ++i) {
+            const float ai = a[i];
+#pragma GCC unroll 32
+            for (int j = 0; j < NR_; ++j) acc[i][j] += ai * b[j];
         }
-        for (int j = 0; j < N; ++j) local_sum += c_row[j];
     }
-    partial_sum = local_sum;
+    if (ep) store_tile_epilogue(&acc[0][0], NR_, C, ldc, mr, nr, accumulate, *ep, row0, col0);
+    else    store_tile(&acc[0][0], NR_, C, ldc, mr, nr, accumulate);
 }
 
-double matmul_parallel_sum(vector<float>& C,
-                           const vector<float>& A,
-                           const vector<float>& B,
-                           int N, int num_threads)
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// AVX2 + FMA: tile 6x16 = 12 acumuladores ymm + 2 de B + 1 broadcast de A (15 de 16 registros).
+__attribute__((target("avx2,fma")))
+static void micro_kernel_avx2_6x16(int kc, const float* __restrict Ap, const float* __restrict Bp,
+                                   float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate,
+                                   const Epilogue* ep, int row0, int col0)
 {
-    num_threads = max(1, min(num_threads, N));
-    vector<thread> ths;
-    vector<double> partial(num_threads, 0.0);
+    __m256 c[6][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; ++i) c[i][0] = c[i][1] = _mm256_setzero_ps();
 
-    int base = N / num_threads, rem = N % num_threads, start = 0;
-    for (int t = 0; t < num_threads; ++t) {
-        int rows = base + (t < rem ? 1 : 0);
-        int i0 = start, i1 = i0 + rows; start = i1;
-        ths.emplace_back(worker_block, cref(A), cref(B), ref(C), N, i0, i1, ref(partial[t]));
+    for (int p = 0; p < kc; ++p) {
+        const __m256 b0 = _mm256_load_ps(Bp);
+        const __m256 b1 = _mm256_load_ps(Bp + 8);
+#pragma GCC unroll 6
+        for (int i = 0; i < 6; ++i) {
+            const __m256 a = _mm256_broadcast_ss(Ap + i);
+            c[i][0] = _mm256_fmadd_ps(a, b0, c[i][0]);
+            c[i][1] = _mm256_fmadd_ps(a, b1, c[i][1]);
+        }
+        Ap += 6;
+        Bp += 16;
+    }
+
+    if (mr == 6 && nr == 16 && !ep) {
+#pragma GCC unroll 6
+        for (int i = 0; i < 6; ++i) {
+            float* ci = C + (ptrdiff_t)i * ldc;
+            if (accumulate) {
+                c[i][0] = _mm256_add_ps(c[i][0], _mm256_loadu_ps(ci));
+                c[i][1] = _mm256_add_ps(c[i][1], _mm256_loadu_ps(ci + 8));
+            }
+            _mm256_storeu_ps(ci, c[i][0]);
+            _mm256_storeu_ps(ci + 8, c[i][1]);
+        }
+    } else {
+        alignas(64) float tmp[6 * 16];
+        for (int i = 0; i < 6; ++i) {
+            _mm256_store_ps(tmp + i * 16, c[i][0]);
+            _mm256_store_ps(tmp + i * 16 + 8, c[i][1]);
+        }
+        if (ep) store_tile_epilogue(tmp, 16, C, ldc, mr, nr, accumulate, *ep, row0, col0);
+        else    store_tile(tmp, 16, C, ldc, mr, nr, accumulate);
+    }
+}
+
+// AVX-512: tile 12x32 = 24 acumuladores zmm + 2 de B + 1 broadcast (27 de 32 registros).
+__attribute__((target("avx512f")))
+static void micro_kernel_avx512_12x32(int kc, const float* __restrict Ap, const float* __restrict Bp,
+                                      float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate,
+                                      const Epilogue* ep, int row0, int col0)
+{
+    __m512 c[12][2];
+#pragma GCC unroll 12
+    for (int i = 0; i < 12; ++i) c[i][0] = c[i][1] = _mm512_setzero_ps();
+
+    for (int p = 0; p < kc; ++p) {
+        const __m512 b0 = _mm512_load_ps(Bp);
+        const __m512 b1 = _mm512_load_ps(Bp + 16);
+#pragma GCC unroll 12
+        for (int i = 0; i < 12; ++i) {
+            const __m512 a = _mm512_set1_ps(Ap[i]);
+            c[i][0] = _mm512_fmadd_ps(a, b0, c[i][0]);
+            c[i][1] = _mm512_fmadd_ps(a, b1, c[i][1]);
+        }
+        Ap += 12;
+        Bp += 32;
+    }
+
+    if (mr == 12 && nr == 32 && !ep) {
+#pragma GCC unroll 12
+        for (int i = 0; i < 12; ++i) {
+            float* ci = C + (ptrdiff_t)i * ldc;
+            if (accumulate) {
+                c[i][0] = _mm512_add_ps(c[i][0], _mm512_loadu_ps(ci));
+                c[i][1] = _mm512_add_ps(c[i][1], _mm512_loadu_ps(ci + 16));
+            }
+            _mm512_storeu_ps(ci, c[i][0]);
+            _mm512_storeu_ps(ci + 16, c[i][1]);
+        }
+    } else {
+        alignas(64) float tmp[12 * 32];
+        for (int i = 0; i < 12; ++i) {
+            _mm512_store_ps(tmp + i * 32, c[i][0]);
+            _mm512_store_ps(tmp + i * 32 + 16, c[i][1]);
+        }
+        if (ep) store_tile_epilogue(tmp, 32, C, ldc, mr, nr, accumulate, *ep, row0, col0);
+        else    store_tile(tmp, 32, C, ldc, mr, nr, accumulate);
+    }
+}
+#endif
+
+// Micro-kernels que puede ejecutar esta CPU, del más portable al más rápido.
+static vector<MicroKernel> available_micro_kernels() {
+    vector<MicroKernel> ks;
+    ks.push_back({"generico-6x16", 6, 16, micro_kernel_generic<6, 16>});
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        ks.push_back({"avx2-fma-6x16", 6, 16, micro_kernel_avx2_6x16});
+    if (__builtin_cpu_supports("avx512f"))
+        ks.push_back({"avx512-12x32", 12, 32, micro_kernel_avx512_12x32});
+#endif
+    return ks;
+}
+
+// El más rápido disponible; MATMUL_KERNEL=<nombre> fuerza otro (p.ej. para comparar).
+static MicroKernel select_micro_kernel() {
+    vector<MicroKernel> ks = available_micro_kernels();
+    if (const char* forced = getenv("MATMUL_KERNEL")) {
+        for (const auto& k : ks) if (string(k.name).rfind(forced, 0) == 0) return k;
+        cerr << "MATMUL_KERNEL=" << forced << " no disponible; se usa " << ks.back().name << "\n";
+    }
+    return ks.back();
+}
+
+static MicroKernel g_kernel = select_micro_kernel();
+
+static long cache_bytes(int name, long fallback) {
+    long v = sysconf(name);
+    return v > 0 ? v : fallback;
+}
+
+// Tamaños de bloque a partir de la jerarquía de caché:
+//   KC*NR floats de B (un micro-panel) ocupan ~la mitad de L1,
+//   MC*KC floats de A ocupan ~la mitad de L2,
+//   KC*NC floats de B ocupan ~la mitad de L3.
+static BlockParams block_params_for_caches(const MicroKernel& mk) {
+    const long L1 = cache_bytes(_SC_LEVEL1_DCACHE_SIZE, 32 << 10);
+    const long L2 = cache_bytes(_SC_LEVEL2_CACHE_SIZE, 1 << 20);
+    const long L3 = cache_bytes(_SC_LEVEL3_CACHE_SIZE, 16 << 20);
+    BlockParams bp;
+    bp.KC = (int)clamp<long>(L1 / 2 / (mk.NR * (long)sizeof(float)), 64, 1024);
+    bp.KC -= bp.KC % 8;
+    bp.MC = (int)clamp<long>(L2 / 2 / (bp.KC * (long)sizeof(float)), mk.MR, 1024);
+    bp.MC -= bp.MC % mk.MR;
+    bp.NC = (int)clamp<long>(L3 / 2 / (bp.KC * (long)sizeof(float)), mk.NR, 8192);
+    bp.NC -= bp.NC % mk.NR;
+    return bp;
+}
+
+static BlockParams g_blk = block_params_for_caches(g_kernel);
+
+// A(i,k) = A[i*rsa + k*csa]. Micro-paneles de MR filas: Ap[p*MR + i], con ceros de relleno.
+// alpha se aplica acá, así el micro-kernel no necesita escalar.
+template <class T>
+static void pack_A(int mc, int kc, const T* A, ptrdiff_t rsa, ptrdiff_t csa,
+                   T* __restrict Ap, int MR, T alpha = T(1)) {
+    for (int ir = 0; ir < mc; ir += MR) {
+        const int mr = min(MR, mc - ir);
+        for (int p = 0; p < kc; ++p) {
+            const T* a = A + (ptrdiff_t)ir * rsa + (ptrdiff_t)p * csa;
+            if (alpha == T(1)) for (int i = 0; i < mr; ++i) Ap[i] = a[(ptrdiff_t)i * rsa];
+            else for (int i = 0; i < mr; ++i) Ap[i] = alpha * a[(ptrdiff_t)i * rsa];
+            for (int i = mr; i < MR; ++i) Ap[i] = T(0);
+            Ap += MR;
+        }
+    }
+}
+
+// B(k,j) = B[k*rsb + j*csb]. Micro-paneles de NR columnas: Bp[p*NR + j], con ceros de relleno.
+template <class T>
+static void pack_B(int kc, int nc, const T* B, ptrdiff_t rsb, ptrdiff_t csb,
+                   T* __restrict Bp, int NR) {
+    for (int jr = 0; jr < nc; jr += NR) {
+        const int nr = min(NR, nc - jr);
+        for (int p = 0; p < kc; ++p) {
+            const T* b = B + (ptrdiff_t)p * rsb + (ptrdiff_t)jr * csb;
+            if (csb == 1 && nr == NR) {
+                memcpy(Bp, b, NR * sizeof(T));
+            } else {
+                for (int j = 0; j < nr; ++j) Bp[j] = b[(ptrdiff_t)j * csb];
+                for (int j = nr; j < NR; ++j) Bp[j] = T(0);
+            }
+            Bp += NR;
+        }
+    }
+}
+
+// C[M x N] = alpha * A[M x K] * B[K x N] (C fila-mayor con paso ldc). No requiere
+// C en cero; con accumulate hace C += alpha * A*B. El epílogo ep (si hay) se
+// aplica en el último panel de k.
+static void gemm_blocked(int M, int N, int K,
+                         const float* A, ptrdiff_t rsa, ptrdiff_t csa,
+                         const float* B, ptrdiff_t rsb, ptrdiff_t csb,
+                         float* C, ptrdiff_t ldc,
+                         const BlockParams& bp = g_blk,
+                         const MicroKernel& mk = g_kernel,
+                         bool accumulate = false,
+                         float alpha = 1.0f,
+                         const Epilogue* ep = nullptr)
+{
+    if (K == 0 && ep) {  // sin producto: el epílogo actúa sobre C (accumulate) o sobre ceros
+        static const float zero[32] = {};
+        for (int i = 0; i < M; ++i)
+            for (int j0 = 0; j0 < N; j0 += 32)
+                store_tile_epilogue(zero, 0, C + (ptrdiff_t)i * ldc + j0, ldc, 1, min(32, N - j0),
+                                    accumulate, *ep, i, j0);
+        return;
+    }
+    if (K == 0) {
+        if (accumulate) return;
+        for (int i = 0; i < M; ++i) fill(C + (ptrdiff_t)i * ldc, C + (ptrdiff_t)i * ldc + N, 0.0f);
+        return;
+    }
+    const int MR = mk.MR, NR = mk.NR;
+    thread_local avec<float> Ap, Bp;
+    const size_t need_a = (size_t)(bp.MC + MR) * bp.KC, need_b = (size_t)(bp.NC + NR) * bp.KC;
+    if (Ap.size() < need_a) Ap.resize(need_a);
+    if (Bp.size() < need_b) Bp.resize(need_b);
+
+    for (int jc = 0; jc < N; jc += bp.NC) {
+        const int nc = min(bp.NC, N - jc);
+        for (int pc = 0; pc < K; pc += bp.KC) {
+            const int kc = min(bp.KC, K - pc);
+            const Epilogue* ep_k = pc + kc == K ? ep : nullptr;
+            pack_B(kc, nc, B + (ptrdiff_t)pc * rsb + (ptrdiff_t)jc * csb, rsb, csb, Bp.data(), NR);
+            for (int ic = 0; ic < M; ic += bp.MC) {
+                const int mc = min(bp.MC, M - ic);
+                pack_A(mc, kc, A + (ptrdiff_t)ic * rsa + (ptrdiff_t)pc * csa, rsa, csa, Ap.data(), MR, alpha);
+                for (int jr = 0; jr < nc; jr += NR) {
+                    const float* bpan = Bp.data() + (size_t)jr * kc;
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        mk.fn(kc, Ap.data() + (size_t)ir * kc, bpan,
+                              C + (ptrdiff_t)(ic + ir) * ldc + jc + jr, ldc,
+                              min(MR, mc - ir), min(NR, nc - jr), accumulate || pc > 0,
+                              ep_k, ic + ir, jc + jr);
+                    }
+                }
+            }
+        }
     }
-    for (auto& th : ths) th.join();
+}
 
+double matmul_blocked_sum(Matrix& C,
+                          const Matrix& A,
+                          const Matrix& B,
+                          int M, int K, int N)
+{
+    gemm_blocked(M, N, K, A.data(), K, 1, B.data(), N, 1, C.data(), N);
     double total = 0.0;
-    for (double s : partial) total += s;
+    for (size_t i = 0; i < (size_t)M * N; ++i) total += C[i];
     return total;
 }
 
-int main(int argc, char** argv) {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
+// ----------------- PLANIFICACIÓN 2D CON ROBO DE TRABAJO + FIRST TOUCH -----------------
+// C se divide en tiles 2D; cada hilo recibe inicialmente los tiles de su franja
+// de filas (la misma que inicializó en first_touch_fill, así A y C están en su
+// nodo NUMA) y cuando vacía su cola roba tiles del final de las colas ajenas.
+// Los hilos se fijan a CPUs (MATMUL_PIN=0 lo desactiva).
 
-    if (argc < 2) {
-        cerr << "Uso: " << argv[0] << " N [hilos] [valorA] [valorB]\n";
-        cerr << "Ej.: " << argv[0] << " 3000 16 0.1 0.2\n";
-        return 1;
+static vector<int> allowed_cpus() {
+    vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) cpus.push_back(c);
     }
+    return cpus;
+}
 
-    const int N = stoi(argv[1]);
-    int hw = (int)thread::hardware_concurrency(); if (hw <= 0) hw = 8;
-    int num_threads = (argc >= 3) ? stoi(argv[2]) : min(20, hw);
-    float a_val = (argc >= 4) ? (float)atof(argv[3]) : 0.1f;
-    float b_val = (argc >= 5) ? (float)atof(argv[4]) : 0.2f;
+static bool pinning_enabled() {
+    const char* e = getenv("MATMUL_PIN");
+    return !(e && string(e) == "0");
+}
 
-    cout << "N=" << N << "  hilos=" << num_threads
-         << "  A=" << a_val << "  B=" << b_val << "\n";
+static bool pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
 
-    vector<float> A((size_t)N * N, a_val);
-    vector<float> B((size_t)N * N, b_val);
-    vector<float> C((size_t)N * N, 0.0f);
+// Hilo t de T "posee" las filas [first, second) de una matriz de M filas.
+static inline pair<int, int> owned_rows(int M, int T, int t) {
+    return {(int)((long long)M * t / T), (int)((long long)M * (t + 1) / T)};
+}
 
-    print_corners("A", corners_of(A, N));
-    print_corners("B", corners_of(B, N));
+// Pool de hilos persistente: lanzar hilos en cada multiplicación cuesta decenas
+// de microsegundos, más que multiplicar una matriz chica. El trabajador t se fija
+// una sola vez a cpus[t % n], la misma asignación que usa first_touch_fill.
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
 
-    auto wait_enter = [&](const string& msg){
-        cout << msg; cout.flush();
-        string line; getline(cin, line);
+    // Ejecuta fn(0..n-1), cada índice en un trabajador distinto, y espera.
+    // Llamado desde dentro de un trabajador se ejecuta en línea (sin anidar).
+    void run(int n, const function<void(int)>& fn) {
+        n = max(1, n);
+        if (in_worker || n == 1) {
+            for (int t = 0; t < n; ++t) fn(t);
+            return;
+        }
+        lock_guard<mutex> serial(run_mtx);
+        ensure_workers(n);
+        unique_lock<mutex> lk(mtx);
+        job = &fn;
+        job_n = n;
+        pending = n;
+        ++generation;
+        cv_work.notify_all();
+        cv_done.wait(lk, [&] { return pending == 0; });
+        job = nullptr;
+    }
+
+    bool pinned() const { return pin; }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lk(mtx);
+            stop = true;
+        }
+        cv_work.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+private:
+    ThreadPool() : cpus(allowed_cpus()), pin(pinning_enabled() && !cpus.empty()) {}
+
+    void ensure_workers(int n) {
+        while ((int)workers.size() < n) {
+            // generation sólo cambia bajo run_mtx: el trabajador nuevo no
+            // re-ejecuta trabajos anteriores ni se pierde el que está por publicarse
+            const int id = (int)workers.size();
+            const long seen = generation;
+            workers.emplace_back([this, id, seen] { worker_loop(id, seen); });
+        }
+    }
+
+    void worker_loop(int id, long seen) {
+        in_worker = true;
+        if (pin) pin_current_thread(cpus[id % cpus.size()]);
+        while (true) {
+            const function<void(int)>* fn;
+            {
+                unique_lock<mutex> lk(mtx);
+                cv_work.wait(lk, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+                if (id >= job_n) continue;
+                fn = job;
+            }
+            (*fn)(id);
+            lock_guard<mutex> lk(mtx);
+            if (--pending == 0) cv_done.notify_one();
+        }
+    }
+
+    vector<int> cpus;
+    bool pin;
+    vector<thread> workers;
+    mutex run_mtx, mtx;
+    condition_variable cv_work, cv_done;
+    const function<void(int)>* job = nullptr;
+    int job_n = 0, pending = 0;
+    long generation = 0;
+    bool stop = false;
+    static thread_local bool in_worker;
+};
+thread_local bool ThreadPool::in_worker = false;
+
+// Inicializa X (rows x cols) en paralelo: cada página la toca primero el hilo
+// (fijado a la misma CPU que en la multiplicación) que trabajará sobre ella.
+void first_touch_fill(Matrix& X, int rows, int cols, float value, int num_threads) {
+    num_threads = max(1, min(num_threads, rows));
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        auto [r0, r1] = owned_rows(rows, num_threads, t);
+        fill(X.data() + (size_t)r0 * cols, X.data() + (size_t)r1 * cols, value);
+    });
+}
+
+struct Tile { int i0, i1, j0, j1; };
+
+struct SchedStats {
+    int tile_m = 0, tile_n = 0;
+    long tiles = 0, steals = 0;
+    bool pinned = false;
+};
+static SchedStats g_sched_stats;  // de la última multiplicación paralela
+
+class TileScheduler {
+public:
+    TileScheduler(int M, int N, int num_threads, int tm, int tn)
+        : T(num_threads), queues(new Queue[num_threads])
+    {
+        for (int i0 = 0; i0 < M; i0 += tm) {
+            const int i1 = min(M, i0 + tm);
+            const int owner = owner_of((i0 + i1) / 2, M);
+            for (int j0 = 0; j0 < N; j0 += tn) {
+                queues[owner].q.push_back({i0, i1, j0, min(N, j0 + tn)});
+                ++total;
+            }
+        }
+    }
+
+    long tiles() const { return total; }
+
+    // Próximo tile para el hilo t: primero su cola (por delante), luego roba
+    // (por detrás) recorriendo las demás colas.
+    bool next(int t, Tile& out, bool& stolen) {
+        {
+            lock_guard<mutex> lk(queues[t].mtx);
+            if (!queues[t].q.empty()) {
+                out = queues[t].q.front();
+                queues[t].q.pop_front();
+                stolen = false;
+                return true;
+            }
+        }
+        for (int d = 1; d < T; ++d) {
+            Queue& v = queues[(t + d) % T];
+            lock_guard<mutex> lk(v.mtx);
+            if (!v.q.empty()) {
+                out = v.q.back();
+                v.q.pop_back();
+                stolen = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct alignas(64) Queue {
+        mutex mtx;
+        deque<Tile> q;
     };
 
-    // ---- Pausa antes de ejecutar SECUENCIAL ----
-    wait_enter("\nPresione ENTER para ejecutar la versión SECUENCIAL...");
-    auto t0 = Clock::now();
-    double sum_seq = matmul_serial_sum(C, A, B, N);
-    auto t1 = Clock::now();
-    double ms_seq = chrono::duration_cast<ms>(t1 - t0).count();
+    int owner_of(int row, int M) const {
+        int t = (int)min<long long>(T - 1, (long long)row * T / max(1, M));
+        while (t > 0 && row < owned_rows(M, T, t).first) --t;
+        while (t < T - 1 && row >= owned_rows(M, T, t).second) ++t;
+        return t;
+    }
 
-    print_corners("C (secuencial)", corners_of(C, N));
-    cout << fixed << setprecision(6);
-    cout << "Sumatoria (secuencial) = " << sum_seq << "\n";
-    cout << "Tiempo secuencial: " << ms_seq/1000.0 << " s (" << ms_seq << " ms)\n";
+    int T;
+    unique_ptr<Queue[]> queues;
+    long total = 0;
+};
 
-    // ---- Pausa antes de ejecutar MULTIHILO ----
-    wait_enter("\nPresione ENTER para ejecutar la versión MULTIHILO...");
-    auto t2 = Clock::now();
-    double sum_par = matmul_parallel_sum(C, A, B, N, num_threads);
-    auto t3 = Clock::now();
-    double ms_par = chrono::duration_cast<ms>(t3 - t2).count();
+// Tiles del tamaño del panel MC, reducidos a la mitad (el lado mayor) hasta
+// tener al menos ~4 tiles por hilo para que el robo pueda balancear.
+// Forma de tile fijada por el perfil de auto-ajuste (0 = elegir automáticamente)
+static int g_tile_m = 0, g_tile_n = 0;
 
-    print_corners("C (multihilo)", corners_of(C, N));
-    cout << "Sumatoria (multihilo) = " << sum_par << "\n";
-    cout << "Tiempo multihilo: " << ms_par/1000.0 << " s (" << ms_par << " ms)\n";
+static void choose_tile_dims(int M, int N, int num_threads, const BlockParams& bp,
+                             const MicroKernel& mk, int& tm, int& tn)
+{
+    auto round_to = [](int v, int q) { return max(q, v / q * q); };
+    if (g_tile_m > 0 && g_tile_n > 0) {
+        tm = round_to(min(g_tile_m, max(M, 1)), mk.MR);
+        tn = round_to(min(g_tile_n, max(N, 1)), mk.NR);
+        return;
+    }
+    tm = round_to(min(bp.MC, max(M, 1)), mk.MR);
+    tn = round_to(min(max(bp.MC, mk.NR), max(N, 1)), mk.NR);
+    auto count = [&]() { return (long)((M + tm - 1) / tm) * ((N + tn - 1) / tn); };
+    while (count() < 4L * num_threads && (tm > mk.MR || tn > mk.NR)) {
+        if (tn >= tm && tn > mk.NR) tn = round_to(tn / 2, mk.NR);
+        else tm = round_to(tm / 2, mk.MR);
+    }
+}
+
+// Ejecuta tile_fn(tile) sobre todos los tiles de un C de M x N con el planificador
+// de robo de trabajo; tile_fn devuelve la sumatoria de su tile.
+template <class TileFn>
+static double run_tiles_parallel(int M, int N, int num_threads, TileFn tile_fn)
+{
+    num_threads = max(1, num_threads);
+    int tm, tn;
+    choose_tile_dims(M, N, num_threads, g_blk, g_kernel, tm, tn);
+    TileScheduler sched(M, N, num_threads, tm, tn);
+
+    vector<double> partial(num_threads, 0.0);
+    vector<long> steals(num_threads, 0);
+
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        double local_sum = 0.0;
+        Tile tl;
+        bool stolen;
+        while (sched.next(t, tl, stolen)) {
+            steals[t] += stolen;
+            local_sum += tile_fn(tl);
+        }
+        partial[t] = local_sum;
+    });
+
+    g_sched_stats = {tm, tn, sched.tiles(), accumulate(steals.begin(), steals.end(), 0L),
+                     ThreadPool::instance().pinned()};
+    double total = 0.0;
+    for (double s : partial) total += s;
+    return total;
+}
+
+// Sumatoria de un tile m x n de C (paso ldc), mientras sigue en caché
+static inline double tile_sum(const float* c, int m, int n, ptrdiff_t ldc) {
+    double s = 0.0;
+    for (int i = 0; i < m; ++i) {
+        const float* c_row = c + (ptrdiff_t)i * ldc;
+        for (int j = 0; j < n; ++j) s += c_row[j];
+    }
+    return s;
+}
+
+// C[M x N] = epílogo(A[M x K] * B[K x N]) en paralelo por tiles; devuelve la
+// sumatoria de y. Con ep.store_c == false, C puede ser nullptr y nunca existe:
+// cada hilo usa un tile de trabajo propio sólo si K necesita más de un panel.
+double gemm_fused(int M, int N, int K, const float* A, const float* B, float* C,
+                  const Epilogue& ep, int num_threads)
+{
+    return run_tiles_parallel(M, N, num_threads, [&](const Tile& tl) {
+        const int m = tl.i1 - tl.i0, n = tl.j1 - tl.j0;
+        Epilogue e = ep;  // punteros relativos al origen del tile
+        if (e.bias_col) e.bias_col += tl.j0;
+        if (e.bias_row) e.bias_row += tl.i0;
+        if (e.row_sums) e.row_sums += tl.i0;
+        if (e.col_sums) e.col_sums += tl.j0;
+        double tile_total = 0.0;
+        e.total = &tile_total;
+
+        float* c;
+        ptrdiff_t ldc;
+        if (ep.store_c) {
+            c = C + (size_t)tl.i0 * N + tl.j0;
+            ldc = N;
+        } else {
+            // Con un solo panel de K el epílogo no lee ni escribe C: alcanza con una
+            // fila ficticia (ldc = 0) para que las direcciones sigan siendo válidas.
+            // Con varios paneles los parciales se acumulan en un tile m x n.
+            const bool one_panel = K <= g_blk.KC;
+            const size_t need = one_panel ? (size_t)n : (size_t)m * n;
+            thread_local avec<float> scratch;
+            if (scratch.size() < need) scratch.resize(need);
+            c = scratch.data();
+            ldc = one_panel ? 0 : n;
+        }
+        gemm_blocked(m, n, K, A + (size_t)tl.i0 * K, K, 1, B + tl.j0, N, 1, c, ldc,
+                     g_blk, g_kernel, false, 1.0f, &e);
+        if (ep.total) atomic_add(ep.total, tile_total);
+        return tile_total;
+    });
+}
+
+// C[M x N] = A[M x K] * B[K x N] en paralelo por tiles; devuelve la sumatoria de C
+// (calculada en el epílogo, sin una segunda pasada sobre C).
+static double gemm_parallel_tiles(int M, int N, int K,
+                                  const float* A, const float* B, float* C,
+                                  int num_threads)
+{
+    return gemm_fused(M, N, K, A, B, C, Epilogue{}, num_threads);
+}
+
+double matmul_parallel_sum(Matrix& C,
+                           const Matrix& A,
+                           const Matrix& B,
+                           int M, int K, int N, int num_threads)
+{
+    return gemm_parallel_tiles(M, N, K, A.data(), B.data(), C.data(), num_threads);
+}
+
+double matmul_parallel_sum(Matrix& C,
+                           const Matrix& A,
+                           const Matrix& B,
+                           int N, int num_threads)
+{
+    return matmul_parallel_sum(C, A, B, N, N, N, num_threads);
+}
+
+// ----------------- INTERFAZ sgemm (estilo BLAS) -----------------
+// C = alpha * op(A) * op(B) + beta * C, con op(X) = X o X^T, fila- o columna-
+// mayor y pasos lda/ldb/ldc. Los valores de los enums coinciden con CBLAS,
+// así que quien llama a cblas_sgemm puede pasar sus argumentos tal cual.
+// No se copia ni transpone nada: la disposición se traduce a pasos (rs, cs)
+// que absorben pack_A/pack_B, y alpha se aplica al empaquetar A. C columna-
+// mayor se resuelve como C^T = op(B)^T * op(A)^T en fila-mayor.
+
+enum SgemmLayout { SgemmRowMajor = 101, SgemmColMajor = 102 };
+enum SgemmOp { SgemmNoTrans = 111, SgemmTrans = 112, SgemmConjTrans = 113 };
+
+void sgemm(SgemmLayout layout, SgemmOp trans_a, SgemmOp trans_b,
+           int M, int N, int K, float alpha,
+           const float* A, int lda, const float* B, int ldb,
+           float beta, float* C, int ldc, int num_threads)
+{
+    const bool ta = trans_a != SgemmNoTrans, tb = trans_b != SgemmNoTrans;
+    const bool row = layout == SgemmRowMajor;
+    if (M < 0 || N < 0 || K < 0) throw invalid_argument("sgemm: dimensión negativa");
+    // Filas y columnas almacenadas de A y B según la disposición
+    const int a_rows = ta ? K : M, a_cols = ta ? M : K;
+    const int b_rows = tb ? N : K, b_cols = tb ? K : N;
+    if (lda < max(1, row ? a_cols : a_rows)) throw invalid_argument("sgemm: lda inválido");
+    if (ldb < max(1, row ? b_cols : b_rows)) throw invalid_argument("sgemm: ldb inválido");
+    if (ldc < max(1, row ? N : M)) throw invalid_argument("sgemm: ldc inválido");
+    if (M == 0 || N == 0) return;
+
+    // op(A)(i,k) = A[i*rsa + k*csa], op(B)(k,j) = B[k*rsb + j*csb] en la disposición pedida
+    ptrdiff_t rsa = lda, csa = 1, rsb = ldb, csb = 1;
+    if (ta != !row) swap(rsa, csa);  // fila-mayor transpuesta o columna-mayor sin transponer
+    if (tb != !row) swap(rsb, csb);
+    // Columna-mayor: C^T (N x M, fila-mayor con paso ldc) = op(B)^T * op(A)^T
+    int m = M, n = N;
+    const float* X = A;
+    const float* Y = B;
+    ptrdiff_t rsx = rsa, csx = csa, rsy = rsb, csy = csb;
+    if (!row) {
+        swap(m, n);
+        X = B; rsx = csb; csx = rsb;
+        Y = A; rsy = csa; csy = rsa;
+    }
+
+    const bool no_product = K == 0 || alpha == 0.0f;
+    run_tiles_parallel(m, n, num_threads, [&](const Tile& tl) {
+        const int tm = tl.i1 - tl.i0, tn = tl.j1 - tl.j0;
+        float* c = C + (ptrdiff_t)tl.i0 * ldc + tl.j0;
+        // beta = 0 no lee C (puede tener basura o NaN, como en BLAS); beta = 1 acumula directo
+        if (beta != 1.0f && (no_product || beta != 0.0f)) {
+            for (int i = 0; i < tm; ++i) {
+                float* c_row = c + (ptrdiff_t)i * ldc;
+                for (int j = 0; j < tn; ++j) c_row[j] = beta == 0.0f ? 0.0f : beta * c_row[j];
+            }
+        }
+        if (!no_product) {
+            gemm_blocked(tm, tn, K, X + tl.i0 * rsx, rsx, csx, Y + tl.j0 * csy, rsy, csy, c, ldc,
+                         g_blk, g_kernel, beta != 0.0f, alpha);
+        }
+        return 0.0;
+    });
+}
+
+// ----------------- GEMM POR TIPO DE ELEMENTO (double, complex<float>, complex<double>) -----------------
+// El mismo lazo de 5 niveles de gemm_blocked, con empaquetado y micro-kernels
+// especializados en tiempo de compilación por tipo:
+//   float            -> el camino a mano de arriba (g_kernel, epílogo, etc.);
+//   double           -> micro-kernels propios (genérico, AVX2 6x8, AVX-512 12x16);
+//   complex<R>       -> se empaquetan planos reales (Re, Im, Re+Im) desde los datos
+//                       intercalados y se usa el micro-kernel real de R: 3M hace 3
+//                       productos reales por tile (P1=ArBr, P2=AiBi, P3=(Ar+Ai)(Br+Bi)),
+//                       4M hace 4 (más exacto, 33% más flops).
+
+template <class T> struct is_complex_t : false_type {};
+template <class R> struct is_complex_t<complex<R>> : true_type {};
+template <class T> using sum_t = conditional_t<is_complex_t<T>::value, complex<double>, double>;
+template <class T> struct real_of { using type = T; };
+template <class R> struct real_of<complex<R>> { using type = R; };
+
+template <class T>
+struct KernelT {
+    const char* name;
+    int MR, NR;
+    void (*fn)(int kc, const T* __restrict Ap, const T* __restrict Bp,
+               T* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate);
+};
+
+template <class T, int MR_, int NR_>
+static void micro_kernel_generic_t(int kc, const T* __restrict Ap, const T* __restrict Bp,
+                                   T* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    T acc[MR_][NR_] = {};
+    for (int p = 0; p < kc; ++p) {
+        const T* a = Ap + p * MR_;
+        const T* b = Bp + p * NR_;
+#pragma GCC unroll 8
+        for (int i = 0; i < MR_; ++i) {
+            const T ai = a[i];
+#pragma GCC unroll 32
+            for (int j = 0; j < NR_; ++j) acc[i][j] += ai * b[j];
+        }
+    }
+    store_tile(&acc[0][0], NR_, C, ldc, mr, nr, accumulate);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX2 + FMA double: 6x8 = 12 acumuladores ymm (4 doubles cada uno)
+__attribute__((target("avx2,fma")))
+static void micro_kernel_avx2_f64_6x8(int kc, const double* __restrict Ap, const double* __restrict Bp,
+                                      double* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    __m256d c[6][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; ++i) c[i][0] = c[i][1] = _mm256_setzero_pd();
+    for (int p = 0; p < kc; ++p) {
+        const __m256d b0 = _mm256_load_pd(Bp), b1 = _mm256_load_pd(Bp + 4);
+#pragma GCC unroll 6
+        for (int i = 0; i < 6; ++i) {
+            const __m256d a = _mm256_broadcast_sd(Ap + i);
+            c[i][0] = _mm256_fmadd_pd(a, b0, c[i][0]);
+            c[i][1] = _mm256_fmadd_pd(a, b1, c[i][1]);
+        }
+        Ap += 6;
+        Bp += 8;
+    }
+    alignas(64) double tmp[6 * 8];
+    for (int i = 0; i < 6; ++i) {
+        _mm256_store_pd(tmp + i * 8, c[i][0]);
+        _mm256_store_pd(tmp + i * 8 + 4, c[i][1]);
+    }
+    store_tile(tmp, 8, C, ldc, mr, nr, accumulate);
+}
+
+// AVX-512 double: 12x16 = 24 acumuladores zmm (8 doubles cada uno)
+__attribute__((target("avx512f")))
+static void micro_kernel_avx512_f64_12x16(int kc, const double* __restrict Ap, const double* __restrict Bp,
+                                          double* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    __m512d c[12][2];
+#pragma GCC unroll 12
+    for (int i = 0; i < 12; ++i) c[i][0] = c[i][1] = _mm512_setzero_pd();
+    for (int p = 0; p < kc; ++p) {
+        const __m512d b0 = _mm512_load_pd(Bp), b1 = _mm512_load_pd(Bp + 8);
+#pragma GCC unroll 12
+        for (int i = 0; i < 12; ++i) {
+            const __m512d a = _mm512_set1_pd(Ap[i]);
+            c[i][0] = _mm512_fmadd_pd(a, b0, c[i][0]);
+            c[i][1] = _mm512_fmadd_pd(a, b1, c[i][1]);
+        }
+        Ap += 12;
+        Bp += 16;
+    }
+    if (mr == 12 && nr == 16) {
+#pragma GCC unroll 12
+        for (int i = 0; i < 12; ++i) {
+            double* ci = C + (ptrdiff_t)i * ldc;
+            if (accumulate) {
+                c[i][0] = _mm512_add_pd(c[i][0], _mm512_loadu_pd(ci));
+                c[i][1] = _mm512_add_pd(c[i][1], _mm512_loadu_pd(ci + 8));
+            }
+            _mm512_storeu_pd(ci, c[i][0]);
+            _mm512_storeu_pd(ci + 8, c[i][1]);
+        }
+    } else {
+        alignas(64) double tmp[12 * 16];
+        for (int i = 0; i < 12; ++i) {
+            _mm512_store_pd(tmp + i * 16, c[i][0]);
+            _mm512_store_pd(tmp + i * 16 + 8, c[i][1]);
+        }
+        store_tile(tmp, 16, C, ldc, mr, nr, accumulate);
+    }
+}
+#endif
+
+// Micro-kernels reales por tipo, del más portable al más rápido
+template <class T> static vector<KernelT<T>> kernels_for();
+
+// Los de float son los MicroKernel de arriba, sin epílogo
+static void f32_generic_6x16(int kc, const float* a, const float* b, float* c, ptrdiff_t ldc, int mr, int nr, bool acc) {
+    micro_kernel_generic<6, 16>(kc, a, b, c, ldc, mr, nr, acc, nullptr, 0, 0);
+}
+#if defined(__x86_64__) || defined(__i386__)
+static void f32_avx2_6x16(int kc, const float* a, const float* b, float* c, ptrdiff_t ldc, int mr, int nr, bool acc) {
+    micro_kernel_avx2_6x16(kc, a, b, c, ldc, mr, nr, acc, nullptr, 0, 0);
+}
+static void f32_avx512_12x32(int kc, const float* a, const float* b, float* c, ptrdiff_t ldc, int mr, int nr, bool acc) {
+    micro_kernel_avx512_12x32(kc, a, b, c, ldc, mr, nr, acc, nullptr, 0, 0);
+}
+#endif
+
+template <> vector<KernelT<float>> kernels_for<float>() {
+    vector<KernelT<float>> ks;
+    ks.push_back({"generico-6x16", 6, 16, f32_generic_6x16});
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        ks.push_back({"avx2-fma-6x16", 6, 16, f32_avx2_6x16});
+    if (__builtin_cpu_supports("avx512f"))
+        ks.push_back({"avx512-12x32", 12, 32, f32_avx512_12x32});
+#endif
+    return ks;
+}
+
+template <> vector<KernelT<double>> kernels_for<double>() {
+    vector<KernelT<double>> ks;
+    ks.push_back({"generico-f64-6x8", 6, 8, micro_kernel_generic_t<double, 6, 8>});
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        ks.push_back({"avx2-fma-f64-6x8", 6, 8, micro_kernel_avx2_f64_6x8});
+    if (__builtin_cpu_supports("avx512f"))
+        ks.push_back({"avx512-f64-12x16", 12, 16, micro_kernel_avx512_f64_12x16});
+#endif
+    return ks;
+}
+
+// El más rápido; con generic = true, el portable (para comparar)
+template <class R>
+static const KernelT<R>& real_kernel(bool generic = false) {
+    static const vector<KernelT<R>> ks = kernels_for<R>();
+    if (generic) return ks.front();
+    // con float se respeta MATMUL_KERNEL / el perfil (g_kernel)
+    if constexpr (is_same_v<R, float>)
+        for (const auto& k : ks) if (string(k.name) == g_kernel.name) return k;
+    return ks.back();
+}
+
+template <class R>
+static BlockParams block_params_t(const KernelT<R>& mk) {
+    if constexpr (is_same_v<R, float>) return g_blk;
+    const long L1 = cache_bytes(_SC_LEVEL1_DCACHE_SIZE, 32 << 10);
+    const long L2 = cache_bytes(_SC_LEVEL2_CACHE_SIZE, 1 << 20);
+    const long L3 = cache_bytes(_SC_LEVEL3_CACHE_SIZE, 16 << 20);
+    BlockParams bp;
+    bp.KC = (int)clamp<long>(L1 / 2 / (mk.NR * (long)sizeof(R)), 64, 1024);
+    bp.KC -= bp.KC % 8;
+    bp.MC = (int)clamp<long>(L2 / 2 / (bp.KC * (long)sizeof(R)), mk.MR, 1024);
+    bp.MC -= bp.MC % mk.MR;
+    bp.NC = (int)clamp<long>(L3 / 2 / (bp.KC * (long)sizeof(R)), mk.NR, 8192);
+    bp.NC -= bp.NC % mk.NR;
+    return bp;
+}
+
+// Real: C[M x N] = A[M x K] * B[K x N], fila-mayor con pasos lda/ldb/ldc
+template <class R>
+static void gemm_blocked_real(int M, int N, int K, const R* A, ptrdiff_t lda, const R* B, ptrdiff_t ldb,
+                              R* C, ptrdiff_t ldc, const KernelT<R>& mk, const BlockParams& bp)
+{
+    if (K == 0) {
+        for (int i = 0; i < M; ++i) fill(C + i * ldc, C + i * ldc + N, R(0));
+        return;
+    }
+    const int MR = mk.MR, NR = mk.NR;
+    thread_local avec<R> Ap, Bp;
+    const size_t need_a = (size_t)(bp.MC + MR) * bp.KC, need_b = (size_t)(bp.NC + NR) * bp.KC;
+    if (Ap.size() < need_a) Ap.resize(need_a);
+    if (Bp.size() < need_b) Bp.resize(need_b);
+    for (int jc = 0; jc < N; jc += bp.NC) {
+        const int nc = min(bp.NC, N - jc);
+        for (int pc = 0; pc < K; pc += bp.KC) {
+            const int kc = min(bp.KC, K - pc);
+            pack_B(kc, nc, B + pc * ldb + jc, ldb, (ptrdiff_t)1, Bp.data(), NR);
+            for (int ic = 0; ic < M; ic += bp.MC) {
+                const int mc = min(bp.MC, M - ic);
+                pack_A(mc, kc, A + ic * lda + pc, lda, (ptrdiff_t)1, Ap.data(), MR);
+                for (int jr = 0; jr < nc; jr += NR)
+                    for (int ir = 0; ir < mc; ir += MR)
+                        mk.fn(kc, Ap.data() + (size_t)ir * kc, Bp.data() + (size_t)jr * kc,
+                              C + (ic + ir) * ldc + jc + jr, ldc, min(MR, mc - ir), min(NR, nc - jr), pc > 0);
+            }
+        }
+    }
+}
+
+// Partes reales que se empaquetan de un operando complejo
+enum class CPart { Re, Im, NegIm, Sum };
+
+template <class R>
+static inline R complex_part(const complex<R>& z, CPart part) {
+    switch (part) {
+    case CPart::Re:    return z.real();
+    case CPart::Im:    return z.imag();
+    case CPart::NegIm: return -z.imag();
+    default:           return z.real() + z.imag();
+    }
+}
+
+// Como pack_A / pack_B pero leyendo los complejos intercalados y dejando un plano real
+template <class R>
+static void pack_A_complex(int mc, int kc, const complex<R>* A, ptrdiff_t lda, R* __restrict Ap, int MR, CPart part) {
+    for (int ir = 0; ir < mc; ir += MR) {
+        const int mr = min(MR, mc - ir);
+        for (int p = 0; p < kc; ++p) {
+            const complex<R>* a = A + ir * lda + p;
+            for (int i = 0; i < mr; ++i) Ap[i] = complex_part(a[i * lda], part);
+            for (int i = mr; i < MR; ++i) Ap[i] = R(0);
+            Ap += MR;
+        }
+    }
+}
+
+template <class R>
+static void pack_B_complex(int kc, int nc, const complex<R>* B, ptrdiff_t ldb, R* __restrict Bp, int NR, CPart part) {
+    for (int jr = 0; jr < nc; jr += NR) {
+        const int nr = min(NR, nc - jr);
+        for (int p = 0; p < kc; ++p) {
+            const complex<R>* b = B + p * ldb + jr;
+            for (int j = 0; j < nr; ++j) Bp[j] = complex_part(b[j], part);
+            for (int j = nr; j < NR; ++j) Bp[j] = R(0);
+            Bp += NR;
+        }
+    }
+}
+
+// Complejo por bloques: los productos reales se acumulan en planos P (m x n, en
+// caché del hilo) y al final se combinan e intercalan en C.
+template <class R>
+static void gemm_blocked_complex(int M, int N, int K, const complex<R>* A, ptrdiff_t lda,
+                                 const complex<R>* B, ptrdiff_t ldb, complex<R>* C, ptrdiff_t ldc,
+                                 bool use_3m, const KernelT<R>& mk, const BlockParams& bp)
+{
+    const int MR = mk.MR, NR = mk.NR;
+    const int nprod = use_3m ? 3 : 4;
+    thread_local avec<R> Ap, Bp, P;
+    const size_t pa = (size_t)(bp.MC + MR) * bp.KC, pb = (size_t)(bp.NC + NR) * bp.KC;
+    if (Ap.size() < 3 * pa) Ap.resize(3 * pa);
+    if (Bp.size() < 3 * pb) Bp.resize(3 * pb);
+    if (P.size() < (size_t)nprod * M * N) P.resize((size_t)nprod * M * N);
+    R* plane[4] = {P.data(), P.data() + (size_t)M * N, P.data() + 2 * (size_t)M * N, P.data() + 3 * (size_t)M * N};
+    if (K == 0) fill(P.begin(), P.begin() + (size_t)nprod * M * N, R(0));
+
+    // 3M: (A parte, B parte) -> plano   P0=ArBr  P1=AiBi  P2=(Ar+Ai)(Br+Bi)
+    // 4M:                               P0=ArBr + (-Ai)Bi = Re   P1=ArBi + AiBr = Im
+    const CPart a_parts[3] = {CPart::Re, CPart::Im, use_3m ? CPart::Sum : CPart::NegIm};
+    const CPart b_parts[3] = {CPart::Re, CPart::Im, CPart::Sum};
+    struct Prod { int a, b, plane; bool acc; };
+    static const Prod prods_3m[] = {{0, 0, 0, false}, {1, 1, 1, false}, {2, 2, 2, false}};
+    static const Prod prods_4m[] = {{0, 0, 0, false}, {2, 1, 0, true}, {0, 1, 1, false}, {1, 0, 1, true}};
+    const Prod* prods = use_3m ? prods_3m : prods_4m;
+    const int na = 3, nb = use_3m ? 3 : 2;
+
+    for (int jc = 0; jc < N; jc += bp.NC) {
+        const int nc = min(bp.NC, N - jc);
+        for (int pc = 0; pc < K; pc += bp.KC) {
+            const int kc = min(bp.KC, K - pc);
+            for (int q = 0; q < nb; ++q)
+                pack_B_complex(kc, nc, B + pc * ldb + jc, ldb, Bp.data() + q * pb, NR, b_parts[q]);
+            for (int ic = 0; ic < M; ic += bp.MC) {
+                const int mc = min(bp.MC, M - ic);
+                for (int q = 0; q < na; ++q)
+                    pack_A_complex(mc, kc, A + ic * lda + pc, lda, Ap.data() + q * pa, MR, a_parts[q]);
+                for (int jr = 0; jr < nc; jr += NR)
+                    for (int ir = 0; ir < mc; ir += MR)
+                        for (int x = 0; x < nprod; ++x) {
+                            const Prod& pr = prods[x];
+                            mk.fn(kc, Ap.data() + pr.a * pa + (size_t)ir * kc, Bp.data() + pr.b * pb + (size_t)jr * kc,
+                                  plane[pr.plane] + (size_t)(ic + ir) * N + jc + jr, N,
+                                  min(MR, mc - ir), min(NR, nc - jr), pr.acc || pc > 0);
+                        }
+            }
+        }
+    }
+
+    for (int i = 0; i < M; ++i) {
+        complex<R>* c = C + i * ldc;
+        const size_t o = (size_t)i * N;
+        if (use_3m) {
+            for (int j = 0; j < N; ++j)
+                c[j] = {plane[0][o + j] - plane[1][o + j], plane[2][o + j] - plane[0][o + j] - plane[1][o + j]};
+        } else {
+            for (int j = 0; j < N; ++j) c[j] = {plane[0][o + j], plane[1][o + j]};
+        }
+    }
+}
+
+// Sumatoria de un tile m x n (en el tipo ancho: double o complex<double>)
+template <class T>
+static sum_t<T> tile_sum_t(const T* c, int m, int n, ptrdiff_t ldc) {
+    sum_t<T> s{};
+    for (int i = 0; i < m; ++i)
+        for (int j = 0; j < n; ++j) s += sum_t<T>(c[i * ldc + j]);
+    return s;
+}
 
-    double rel_diff = fabs(sum_seq - sum_par) / max(1.0, fabs(sum_seq));
-    if (rel_diff > 1e-5) {
-        cout << "ADVERTENCIA: diferencia relativa entre sumatorias = " << rel_diff << "\n";
+// C[M x N] = A[M x K] * B[K x N] (fila-mayor, contiguas) en paralelo por tiles;
+// devuelve la sumatoria de C. float usa el camino a mano (gemm_parallel_tiles).
+template <class T>
+sum_t<T> gemm_typed(int M, int N, int K, const T* A, const T* B, T* C, int num_threads,
+                    bool use_3m = true, bool generic = false)
+{
+    if constexpr (is_same_v<T, float>) {
+        if (!generic) return gemm_parallel_tiles(M, N, K, A, B, C, num_threads);
+    }
+    using R = typename real_of<T>::type;
+    const KernelT<R>& mk = real_kernel<R>(generic);
+    const BlockParams bp = block_params_t(mk);
+    mutex mtx;
+    sum_t<T> total{};
+    run_tiles_parallel(M, N, num_threads, [&](const Tile& tl) {
+        const int m = tl.i1 - tl.i0, n = tl.j1 - tl.j0;
+        T* c = C + (size_t)tl.i0 * N + tl.j0;
+        if constexpr (is_complex_t<T>::value)
+            gemm_blocked_complex<R>(m, n, K, A + (size_t)tl.i0 * K, K, B + tl.j0, N, c, N, use_3m, mk, bp);
+        else
+            gemm_blocked_real<R>(m, n, K, A + (size_t)tl.i0 * K, K, B + tl.j0, N, c, N, mk, bp);
+        const sum_t<T> s = tile_sum_t(c, m, n, N);
+        lock_guard<mutex> lk(mtx);
+        total += s;
+        return 0.0;
+    });
+    return total;
+}
+
+// ----------------- GEMM POR LOTES -----------------
+// Miles de multiplicaciones (de igual o distinta forma) en una sola llamada.
+// Cada matriz es una tarea; las grandes se parten además en tiles. Las tareas
+// se ordenan de mayor a menor costo y los trabajadores del pool las toman de
+// un contador atómico, así no se lanza ningún hilo por multiplicación.
+
+struct GemmBatchItem {
+    int M, N, K;
+    const float* A;  // M x K fila-mayor
+    const float* B;  // K x N fila-mayor
+    float* C;        // M x N fila-mayor
+};
+
+// Matrices chicas: sin empaquetado (copiar los paneles cuesta más que multiplicar)
+static void gemm_small(int M, int N, int K, const float* A, ptrdiff_t lda,
+                       const float* B, ptrdiff_t ldb, float* C, ptrdiff_t ldc)
+{
+    for (int i = 0; i < M; ++i) {
+        float* __restrict c_row = C + (ptrdiff_t)i * ldc;
+        for (int j = 0; j < N; ++j) c_row[j] = 0.0f;
+        for (int k = 0; k < K; ++k) {
+            const float a = A[(ptrdiff_t)i * lda + k];
+            const float* __restrict b_row = B + (ptrdiff_t)k * ldb;
+            for (int j = 0; j < N; ++j) c_row[j] += a * b_row[j];
+        }
+    }
+}
+
+static inline bool is_small_gemm(int M, int N, int K) {
+    return (long long)M * N * K <= 48LL * 48 * 48;
+}
+
+// Resuelve el lote; si sums != nullptr deja en (*sums)[b] la sumatoria de C_b.
+void gemm_batch(const vector<GemmBatchItem>& batch, int num_threads, vector<double>* sums = nullptr)
+{
+    struct Task { int item; Tile tile; double cost; };
+    vector<Task> tasks;
+    tasks.reserve(batch.size());
+    num_threads = max(1, num_threads);
+    const long long tile_flops = (long long)g_blk.MC * g_blk.MC * 256;
+    for (int b = 0; b < (int)batch.size(); ++b) {
+        const GemmBatchItem& it = batch[b];
+        if (it.M <= 0 || it.N <= 0) continue;
+        const long long flops = (long long)it.M * it.N * max(1, it.K);
+        if (flops <= tile_flops) {
+            tasks.push_back({b, {0, it.M, 0, it.N}, (double)flops});
+        } else {
+            int tm, tn;
+            choose_tile_dims(it.M, it.N, num_threads, g_blk, g_kernel, tm, tn);
+            for (int i0 = 0; i0 < it.M; i0 += tm)
+                for (int j0 = 0; j0 < it.N; j0 += tn) {
+                    Tile tl{i0, min(it.M, i0 + tm), j0, min(it.N, j0 + tn)};
+                    tasks.push_back({b, tl, (double)(tl.i1 - tl.i0) * (tl.j1 - tl.j0) * it.K});
+                }
+        }
+    }
+    // Mayor costo primero: las tareas grandes no quedan para el final (LPT)
+    stable_sort(tasks.begin(), tasks.end(), [](const Task& x, const Task& y) { return x.cost > y.cost; });
+
+    vector<double> task_sum(tasks.size(), 0.0);
+    atomic<size_t> next(0);
+    ThreadPool::instance().run(num_threads, [&](int) {
+        for (size_t t; (t = next.fetch_add(1, memory_order_relaxed)) < tasks.size();) {
+            const GemmBatchItem& it = batch[tasks[t].item];
+            const Tile& tl = tasks[t].tile;
+            const int m = tl.i1 - tl.i0, n = tl.j1 - tl.j0;
+            const float* a = it.A + (size_t)tl.i0 * it.K;
+            const float* b = it.B + tl.j0;
+            float* c = it.C + (size_t)tl.i0 * it.N + tl.j0;
+            if (is_small_gemm(m, n, it.K)) gemm_small(m, n, it.K, a, it.K, b, it.N, c, it.N);
+            else gemm_blocked(m, n, it.K, a, it.K, 1, b, it.N, 1, c, it.N);
+            if (sums) task_sum[t] = tile_sum(c, m, n, it.N);
+        }
+    });
+
+    if (sums) {
+        sums->assign(batch.size(), 0.0);
+        for (size_t t = 0; t < tasks.size(); ++t) (*sums)[tasks[t].item] += task_sum[t];
+    }
+}
+
+
+
+// ----------------- STRASSEN-WINOGRAD -----------------
+// Variante de Winograd (7 productos, 15 sumas) sobre cuadrantes h x h:
+//   S1=A21+A22  S2=S1-A11  S3=A11-A21  S4=A12-S2
+//   T1=B12-B11  T2=B22-T1  T3=B22-B12  T4=T2-B21
+//   P1=A11*B11  P2=A12*B21  P3=S4*B22  P4=A22*T4  P5=S1*T1  P6=S2*T2  P7=S3*T3
+//   C11=P1+P2   U2=P1+P6   U3=U2+P7   U4=U2+P5
+//   C12=U4+P3   C21=U3-P4  C22=U3+P5
+// Se recursa hasta "cutoff" y ahí se usa el GEMM clásico por bloques. Todo el
+// paralelismo va por el ThreadPool: las sumas se reparten por filas y los
+// productos son tareas de una cola común. Con más de 7 hilos se abre un nivel
+// más (49 productos) para que no queden trabajadores ociosos, ya que el pool no
+// anida. Los temporales salen de un único workspace reservado de antemano.
+
+struct StrassenPlan {
+    int cutoff = 1024;
+    int levels = 0;
+    int padded = 0;  // N rellenado a m * 2^levels
+};
+
+static StrassenPlan strassen_plan(int N, int cutoff) {
+    StrassenPlan sp;
+    sp.cutoff = max(16, cutoff);
+    while (((N + (1 << sp.levels) - 1) >> sp.levels) > sp.cutoff) ++sp.levels;
+    const int m = (N + (1 << sp.levels) - 1) >> sp.levels;
+    sp.padded = m << sp.levels;
+    return sp;
+}
+
+static inline int strassen_slots(int threads) { return threads > 1 ? min(7, threads) : 1; }
+// Con más de 7 hilos y al menos 2 niveles, el nivel superior reparte 49 nietos
+static inline bool strassen_expand(int levels, int threads) { return threads > 7 && levels >= 2; }
+
+// floats de workspace que necesita un nivel de tamaño n (incluye sus descendientes)
+static size_t strassen_workspace(int n, int levels, int threads) {
+    if (levels == 0) return 0;
+    const size_t h = (size_t)n / 2, q = h / 2;
+    if (strassen_expand(levels, threads))
+        return 15 * h * h + 7 * 15 * q * q + (size_t)threads * strassen_workspace((int)q, levels - 2, 1);
+    return 15 * h * h + (size_t)strassen_slots(threads) * strassen_workspace((int)h, levels - 1, 1);
+}
+
+// X = Y op Z sobre bloques h x h con pasos propios (op: +1 suma, -1 resta)
+// (las filas se reparten entre "threads" trabajadores del pool: en los niveles
+// altos estas pasadas O(h^2) limitadas por memoria no deben quedar en un solo hilo)
+static void block_addsub(int h, float* X, ptrdiff_t ldx, const float* Y, ptrdiff_t ldy,
+                         const float* Z, ptrdiff_t ldz, float sign, int threads = 1)
+{
+    auto rows = [=](int r0, int r1) {
+        for (int i = r0; i < r1; ++i) {
+            float* x = X + i * ldx;
+            const float* y = Y + i * ldy;
+            const float* z = Z + i * ldz;
+            for (int j = 0; j < h; ++j) x[j] = y[j] + sign * z[j];
+        }
+    };
+    threads = min(threads, max(1, h / 64));
+    if (threads <= 1) { rows(0, h); return; }
+    ThreadPool::instance().run(threads, [&](int t) {
+        auto [r0, r1] = owned_rows(h, threads, t);
+        rows(r0, r1);
+    });
+}
+
+// Un nivel de Strassen: cuadrantes de A, B, C y sus temporales S, T, P en ws
+struct StrassenNode {
+    int h;
+    const float *A11, *A12, *A21, *A22;
+    const float *B11, *B12, *B21, *B22;
+    float *C11, *C12, *C21, *C22;
+    ptrdiff_t lda, ldb, ldc;
+    float *S[4], *T[4], *P[7];
+    struct Prod { const float* x; ptrdiff_t ldx; const float* y; ptrdiff_t ldy; };
+    Prod prod[7];
+
+    StrassenNode(int n, const float* A, ptrdiff_t lda_, const float* B, ptrdiff_t ldb_,
+                 float* C, ptrdiff_t ldc_, float* ws)
+        : h(n / 2), lda(lda_), ldb(ldb_), ldc(ldc_)
+    {
+        const size_t hh = (size_t)h * h;
+        A11 = A; A12 = A + h; A21 = A + h * lda; A22 = A21 + h;
+        B11 = B; B12 = B + h; B21 = B + h * ldb; B22 = B21 + h;
+        C11 = C; C12 = C + h; C21 = C + h * ldc; C22 = C21 + h;
+        for (int i = 0; i < 4; ++i) S[i] = ws + hh * i;
+        for (int i = 0; i < 4; ++i) T[i] = ws + hh * (4 + i);
+        for (int i = 0; i < 7; ++i) P[i] = ws + hh * (8 + i);
+        const Prod p[7] = {
+            {A11, lda, B11, ldb}, {A12, lda, B21, ldb}, {S[3], h, B22, ldb}, {A22, lda, T[3], h},
+            {S[0], h, T[0], h},   {S[1], h, T[1], h},   {S[2], h, T[2], h}};
+        copy(p, p + 7, prod);
+    }
+
+    // S y T (8 sumas) antes de los productos
+    void pre(int threads) const {
+        block_addsub(h, S[0], h, A21, lda, A22, lda, +1.f, threads);
+        block_addsub(h, S[1], h, S[0], h, A11, lda, -1.f, threads);
+        block_addsub(h, S[2], h, A11, lda, A21, lda, -1.f, threads);
+        block_addsub(h, S[3], h, A12, lda, S[1], h, -1.f, threads);
+        block_addsub(h, T[0], h, B12, ldb, B11, ldb, -1.f, threads);
+        block_addsub(h, T[1], h, B22, ldb, T[0], h, -1.f, threads);
+        block_addsub(h, T[2], h, B22, ldb, B12, ldb, -1.f, threads);
+        block_addsub(h, T[3], h, T[1], h, B21, ldb, -1.f, threads);
+    }
+
+    // Combinación (U2 se acumula en P[5] y U3 en P[6] para no pedir más memoria)
+    void post(int threads) const {
+        block_addsub(h, C11, ldc, P[0], h, P[1], h, +1.f, threads);   // C11 = P1 + P2
+        block_addsub(h, P[5], h, P[0], h, P[5], h, +1.f, threads);    // U2  = P1 + P6
+        block_addsub(h, P[6], h, P[5], h, P[6], h, +1.f, threads);    // U3  = U2 + P7
+        block_addsub(h, P[5], h, P[5], h, P[4], h, +1.f, threads);    // U4  = U2 + P5
+        block_addsub(h, C12, ldc, P[5], h, P[2], h, +1.f, threads);   // C12 = U4 + P3
+        block_addsub(h, C21, ldc, P[6], h, P[3], h, -1.f, threads);   // C21 = U3 - P4
+        block_addsub(h, C22, ldc, P[6], h, P[4], h, +1.f, threads);   // C22 = U3 + P5
+    }
+};
+
+static void strassen_rec(int n, int levels, int threads,
+                         const float* A, ptrdiff_t lda, const float* B, ptrdiff_t ldb,
+                         float* C, ptrdiff_t ldc, float* ws)
+{
+    if (levels == 0) {
+        gemm_blocked(n, n, n, A, lda, 1, B, ldb, 1, C, ldc);
+        return;
+    }
+    const StrassenNode nd(n, A, lda, B, ldb, C, ldc, ws);
+    const int h = nd.h;
+    const size_t hh = (size_t)h * h;
+    float* child_ws = ws + 15 * hh;
+    nd.pre(threads);
+
+    if (threads <= 1) {
+        for (int i = 0; i < 7; ++i)
+            strassen_rec(h, levels - 1, 1, nd.prod[i].x, nd.prod[i].ldx, nd.prod[i].y, nd.prod[i].ldy,
+                         nd.P[i], h, child_ws);
+    } else if (!strassen_expand(levels, threads)) {
+        // Cola común de 7 productos; cada trabajador usa su propio trozo de workspace
+        const size_t child_size = strassen_workspace(h, levels - 1, 1);
+        atomic<int> next(0);
+        ThreadPool::instance().run(strassen_slots(threads), [&](int s) {
+            for (int i; (i = next.fetch_add(1)) < 7;)
+                strassen_rec(h, levels - 1, 1, nd.prod[i].x, nd.prod[i].ldx, nd.prod[i].y, nd.prod[i].ldy,
+                             nd.P[i], h, child_ws + (size_t)s * child_size);
+        });
+    } else {
+        // Nivel extra: S/T de los 7 hijos, cola común de 49 nietos, combinación de los hijos
+        const int q = h / 2;
+        const size_t child_size = 15 * (size_t)q * q;
+        float* grand_ws = child_ws + 7 * child_size;
+        const size_t grand_size = strassen_workspace(q, levels - 2, 1);
+        vector<StrassenNode> kids;
+        kids.reserve(7);
+        for (int i = 0; i < 7; ++i)
+            kids.emplace_back(h, nd.prod[i].x, nd.prod[i].ldx, nd.prod[i].y, nd.prod[i].ldy,
+                              nd.P[i], (ptrdiff_t)h, child_ws + (size_t)i * child_size);
+        auto& pool = ThreadPool::instance();
+        pool.run(7, [&](int i) { kids[i].pre(1); });
+        atomic<int> next(0);
+        pool.run(threads, [&](int s) {
+            for (int k; (k = next.fetch_add(1)) < 49;) {
+                const StrassenNode& kd = kids[k / 7];
+                const auto& pr = kd.prod[k % 7];
+                strassen_rec(q, levels - 2, 1, pr.x, pr.ldx, pr.y, pr.ldy, kd.P[k % 7], q,
+                             grand_ws + (size_t)s * grand_size);
+            }
+        });
+        pool.run(7, [&](int i) { kids[i].post(1); });
+    }
+
+    nd.post(threads);
+}
+
+// C = A * B (N x N) con Strassen-Winograd; N impar o no divisible por 2^niveles se
+// rellena con ceros hasta sp.padded. Devuelve la sumatoria de C.
+double matmul_strassen_sum(Matrix& C, const Matrix& A, const Matrix& B,
+                           int N, int num_threads, const StrassenPlan& sp)
+{
+    const int P = sp.padded;
+    const float *a = A.data(), *b = B.data();
+    float* c = C.data();
+    Matrix Ap, Bp, Cp;
+    if (P != N) {
+        Ap.assign((size_t)P * P, 0.0f);
+        Bp.assign((size_t)P * P, 0.0f);
+        Cp.resize((size_t)P * P);
+        for (int i = 0; i < N; ++i) {
+            copy(A.data() + (size_t)i * N, A.data() + (size_t)(i + 1) * N, Ap.data() + (size_t)i * P);
+            copy(B.data() + (size_t)i * N, B.data() + (size_t)(i + 1) * N, Bp.data() + (size_t)i * P);
+        }
+        a = Ap.data(); b = Bp.data(); c = Cp.data();
+    }
+
+    avec<float> ws(strassen_workspace(P, sp.levels, max(1, num_threads)));
+    strassen_rec(P, sp.levels, max(1, num_threads), a, P, b, P, c, P, ws.data());
+
+    double total = 0.0;
+    for (int i = 0; i < N; ++i) {
+        const float* src = c + (size_t)i * P;
+        if (P != N) copy(src, src + N, C.data() + (size_t)i * N);
+        for (int j = 0; j < N; ++j) total += src[j];
+    }
+    return total;
+}
+
+// ----------------- DISPOSICIÓN MORTON (orden Z) Y MULTIPLICACIÓN CACHE-OBLIVIOUS -----------------
+// Cada matriz se parte en 2^L x 2^L hojas. Las hojas son tiles fila-mayor de
+// tm x tk (A), tk x tn (B) y tm x tn (C), guardadas contiguas en orden Z del
+// índice de hoja, así que cualquier cuadrante a cualquier nivel es un bloque
+// contiguo de memoria. La multiplicación divide C en cuadrantes recursivamente
+// (C_ij += A_i0 B_0j + A_i1 B_1j) hasta la hoja. Así la localidad se da en todos
+// los niveles de caché sin elegir tamaños por máquina; la hoja sólo tiene que
+// ser chica (unas decenas a cientos de elementos por lado).
+// En paralelo, los bloques de C a la profundidad d (4^d >= 4·hilos) son tareas
+// independientes que los hilos del pool toman de un contador atómico.
+
+struct MortonLayout {
+    int L = 0;                 // niveles: 2^L hojas por lado
+    int tm = 0, tk = 0, tn = 0;  // tamaño de hoja
+    size_t leaf_a() const { return (size_t)tm * tk; }
+    size_t leaf_b() const { return (size_t)tk * tn; }
+    size_t leaf_c() const { return (size_t)tm * tn; }
+    size_t tiles() const { return (size_t)1 << (2 * L); }
+};
+
+static MortonLayout morton_layout(int M, int K, int N, int leaf) {
+    MortonLayout ml;
+    const int big = max({M, K, N});
+    while (((long long)leaf << ml.L) < big) ++ml.L;
+    auto side = [&](int dim) { return max(1, (int)(((long long)dim + (1 << ml.L) - 1) >> ml.L)); };
+    ml.tm = side(M);
+    ml.tk = side(K);
+    ml.tn = side(N);
+    return ml;
+}
+
+// Intercala los bits de i (posiciones impares) y j (pares)
+static inline uint64_t morton_index(uint32_t i, uint32_t j) {
+    auto spread = [](uint64_t x) {
+        x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+        x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+        x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        x = (x | (x << 2)) & 0x3333333333333333ULL;
+        x = (x | (x << 1)) & 0x5555555555555555ULL;
+        return x;
+    };
+    return (spread(i) << 1) | spread(j);
+}
+
+// Fila-mayor (rows x cols) -> Morton con hojas tr x tc (relleno con ceros)
+static void to_morton(const float* src, int rows, int cols, int L, int tr, int tc, float* dst, int num_threads) {
+    const int tiles = 1 << L;
+    num_threads = max(1, min(num_threads, tiles));
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        auto [b0, b1] = owned_rows(tiles, num_threads, t);
+        for (int bi = b0; bi < b1; ++bi)
+            for (int bj = 0; bj < tiles; ++bj) {
+                float* leaf = dst + morton_index(bi, bj) * (size_t)tr * tc;
+                for (int i = 0; i < tr; ++i) {
+                    const int gi = bi * tr + i;
+                    float* out = leaf + (size_t)i * tc;
+                    const int gj0 = bj * tc, n = gi < rows ? max(0, min(tc, cols - gj0)) : 0;
+                    if (n > 0) memcpy(out, src + (size_t)gi * cols + gj0, n * sizeof(float));
+                    fill(out + n, out + tc, 0.0f);
+                }
+            }
+    });
+}
+
+static void from_morton(const float* src, int rows, int cols, int L, int tr, int tc, float* dst, int num_threads) {
+    const int tiles = 1 << L;
+    num_threads = max(1, min(num_threads, tiles));
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        auto [b0, b1] = owned_rows(tiles, num_threads, t);
+        for (int bi = b0; bi < b1; ++bi)
+            for (int bj = 0; bj < tiles; ++bj) {
+                const float* leaf = src + morton_index(bi, bj) * (size_t)tr * tc;
+                for (int i = 0; i < tr && bi * tr + i < rows; ++i) {
+                    const int gj0 = bj * tc, n = max(0, min(tc, cols - gj0));
+                    if (n > 0) memcpy(dst + (size_t)(bi * tr + i) * cols + gj0, leaf + (size_t)i * tc, n * sizeof(float));
+                }
+            }
+    });
+}
+
+// C += A·B sobre bloques Morton de 2^l x 2^l hojas
+static void morton_multiply_rec(const MortonLayout& ml, int l, const float* A, const float* B, float* C) {
+    if (l == 0) {
+        gemm_blocked(ml.tm, ml.tn, ml.tk, A, ml.tk, 1, B, ml.tn, 1, C, ml.tn, g_blk, g_kernel, true);
+        return;
+    }
+    const size_t qa = ml.leaf_a() << (2 * (l - 1)), qb = ml.leaf_b() << (2 * (l - 1)), qc = ml.leaf_c() << (2 * (l - 1));
+    for (int i = 0; i < 2; ++i)
+        for (int j = 0; j < 2; ++j)
+            for (int k = 0; k < 2; ++k)
+                morton_multiply_rec(ml, l - 1, A + (2 * i + k) * qa, B + (2 * k + j) * qb, C + (2 * i + j) * qc);
+}
+
+// C = A·B con A, B, C en disposición Morton (C se sobrescribe)
+static void morton_multiply(const MortonLayout& ml, const float* A, const float* B, float* C, int num_threads) {
+    num_threads = max(1, num_threads);
+    int d = 0;
+    while (d < ml.L && ((size_t)1 << (2 * d)) < (size_t)4 * num_threads) ++d;
+    const int side = 1 << d, sub = ml.L - d;
+    const size_t sa = ml.leaf_a() << (2 * sub), sb = ml.leaf_b() << (2 * sub), sc = ml.leaf_c() << (2 * sub);
+    atomic<int> next{0};
+    ThreadPool::instance().run(num_threads, [&](int) {
+        for (int task; (task = next.fetch_add(1, memory_order_relaxed)) < side * side;) {
+            // Tareas en orden Z: las vecinas comparten paneles de A o de B
+            const uint32_t bi = task / side, bj = task % side;
+            float* c = C + morton_index(bi, bj) * sc;
+            fill(c, c + sc, 0.0f);
+            for (uint32_t k = 0; k < (uint32_t)side; ++k)
+                morton_multiply_rec(ml, sub, A + morton_index(bi, k) * sa, B + morton_index(k, bj) * sb, c);
+        }
+    });
+}
+
+// ----------------- PRECISIÓN MIXTA: bf16 / fp16 (acumula fp32) e int8 -> int32 -----------------
+// A y B se guardan en 16 u 8 bits: la mitad o la cuarta parte del tráfico de
+// memoria de fp32. Cada formato tiene su empaquetado y su micro-kernel 6x16:
+//  - bf16/fp16: B se empaqueta sin convertir (16 bits, la mitad de L1/L2 por
+//    panel) y el kernel lo expande a fp32 en registros antes de la FMA; A se
+//    convierte a fp32 al empaquetar (el panel de A vive en L2).
+//  - int8: escalas por fila de A y por columna de B (= por fila de B^T):
+//    C[i][j] = sa[i] * sb[j] * sum_k qa[i][k] * qb[k][j]. Se empaqueta por pares
+//    de k en int16 para usar madd_epi16 (dos productos por lane, suma exacta en int32).
+
+enum class LowPrec { BF16, FP16, INT8 };
+
+static const char* lowprec_name(LowPrec p) {
+    return p == LowPrec::BF16 ? "bf16" : p == LowPrec::FP16 ? "fp16" : "int8";
+}
+
+static inline uint16_t float_to_bf16(float f) {
+    uint32_t x;
+    memcpy(&x, &f, 4);
+    if ((x & 0x7fffffffu) > 0x7f800000u) return (uint16_t)((x >> 16) | 0x40);  // NaN
+    x += 0x7fffu + ((x >> 16) & 1);  // redondeo al par más cercano
+    return (uint16_t)(x >> 16);
+}
+
+static inline float bf16_to_float(uint16_t h) {
+    uint32_t x = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &x, 4);
+    return f;
+}
+
+static inline uint16_t float_to_fp16(float f) {
+    uint32_t x;
+    memcpy(&x, &f, 4);
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    const uint32_t ax = x & 0x7fffffffu;
+    if (ax >= 0x7f800000u) return (uint16_t)(sign | 0x7c00u | (ax > 0x7f800000u ? 0x200u : 0));
+    if (ax >= 0x477ff000u) return (uint16_t)(sign | 0x7c00u);  // desborda a infinito
+    if (ax < 0x38800000u) {                                     // subnormal o cero
+        if (ax < 0x33000000u) return (uint16_t)sign;
+        const uint32_t e = ax >> 23, m = (ax & 0x7fffffu) | 0x800000u;
+        const uint32_t shift = 126 - e;  // 14..24
+        uint32_t r = m >> shift;
+        const uint32_t rem = m & ((1u << shift) - 1), half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (r & 1))) ++r;
+        return (uint16_t)(sign | r);
+    }
+    uint32_t r = ax - 0x38000000u;  // re-sesgo del exponente (127 -> 15)
+    r += 0xfffu + ((r >> 13) & 1);
+    return (uint16_t)(sign | (r >> 13));
+}
+
+static inline float fp16_to_float(uint16_t h) {
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t e = (h >> 10) & 0x1f, m = h & 0x3ffu, x;
+    if (e == 0) {
+        if (m == 0) x = sign;
+        else {  // subnormal: normalizar
+            e = 113;
+            while (!(m & 0x400u)) { m <<= 1; --e; }
+            x = sign | (e << 23) | ((m & 0x3ffu) << 13);
+        }
+    } else if (e == 31) {
+        x = sign | 0x7f800000u | (m << 13);
+    } else {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    }
+    float f;
+    memcpy(&f, &x, 4);
+    return f;
+}
+
+// Matriz cuantizada: 16 bits (bf16/fp16) o int8 con escalas
+struct LowPrecMatrix {
+    LowPrec prec;
+    int rows = 0, cols = 0;
+    avec<uint16_t> h16;
+    avec<int8_t> q8;
+    avec<float> scale;  // int8: por fila (A) o por columna (B)
+
+    size_t bytes() const {
+        return h16.size() * sizeof(uint16_t) + q8.size() + scale.size() * sizeof(float);
+    }
+};
+
+// per_row = true: una escala por fila (A); false: una por columna (B).
+static LowPrecMatrix quantize(const Matrix& X, int rows, int cols, LowPrec prec, bool per_row) {
+    LowPrecMatrix q;
+    q.prec = prec;
+    q.rows = rows;
+    q.cols = cols;
+    const size_t n = (size_t)rows * cols;
+    if (prec != LowPrec::INT8) {
+        q.h16.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            q.h16[i] = prec == LowPrec::BF16 ? float_to_bf16(X[i]) : float_to_fp16(X[i]);
+        return q;
+    }
+    q.q8.resize(n);
+    q.scale.assign(per_row ? rows : cols, 0.0f);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j) {
+            float& s = q.scale[per_row ? i : j];
+            s = max(s, fabs(X[(size_t)i * cols + j]));
+        }
+    for (float& s : q.scale) s = s > 0.0f ? s / 127.0f : 1.0f;
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j) {
+            const float s = q.scale[per_row ? i : j];
+            q.q8[(size_t)i * cols + j] = (int8_t)clamp(lrintf(X[(size_t)i * cols + j] / s), -127L, 127L);
+        }
+    return q;
+}
+
+constexpr int LP_MR = 6, LP_NR = 16;
+
+// ---- empaquetado 16 bits ----
+template <bool FP16>
+static inline float half_to_float(uint16_t h) { return FP16 ? fp16_to_float(h) : bf16_to_float(h); }
+
+template <bool FP16>
+static void pack_A_h16(int mc, int kc, const uint16_t* A, ptrdiff_t lda, float* __restrict Ap) {
+    for (int ir = 0; ir < mc; ir += LP_MR) {
+        const int mr = min(LP_MR, mc - ir);
+        for (int p = 0; p < kc; ++p) {
+            for (int i = 0; i < mr; ++i) Ap[i] = half_to_float<FP16>(A[(ptrdiff_t)(ir + i) * lda + p]);
+            for (int i = mr; i < LP_MR; ++i) Ap[i] = 0.0f;
+            Ap += LP_MR;
+        }
+    }
+}
+
+static void pack_B_h16(int kc, int nc, const uint16_t* B, ptrdiff_t ldb, uint16_t* __restrict Bp) {
+    for (int jr = 0; jr < nc; jr += LP_NR) {
+        const int nr = min(LP_NR, nc - jr);
+        for (int p = 0; p < kc; ++p) {
+            const uint16_t* b = B + (ptrdiff_t)p * ldb + jr;
+            for (int j = 0; j < nr; ++j) Bp[j] = b[j];
+            for (int j = nr; j < LP_NR; ++j) Bp[j] = 0;
+            Bp += LP_NR;
+        }
+    }
+}
+
+template <bool FP16>
+static void micro_kernel_h16_generic(int kc, const float* __restrict Ap, const uint16_t* __restrict Bp,
+                                     float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    float acc[LP_MR][LP_NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        float b[LP_NR];
+        for (int j = 0; j < LP_NR; ++j) b[j] = half_to_float<FP16>(Bp[p * LP_NR + j]);
+        for (int i = 0; i < LP_MR; ++i)
+            for (int j = 0; j < LP_NR; ++j) acc[i][j] += Ap[p * LP_MR + i] * b[j];
+    }
+    store_tile(&acc[0][0], LP_NR, C, ldc, mr, nr, accumulate);
+}
+
+// ---- empaquetado int8 (pares de k en int16) ----
+// Ap: por cada par de k y fila, un int32 = (a[k] en los 16 bits bajos, a[k+1] en los altos)
+static void pack_A_i8(int mc, int kc, const int8_t* A, ptrdiff_t lda, int K, int32_t* __restrict Ap) {
+    for (int ir = 0; ir < mc; ir += LP_MR) {
+        const int mr = min(LP_MR, mc - ir);
+        for (int p = 0; p < kc; p += 2) {
+            for (int i = 0; i < LP_MR; ++i) {
+                int16_t lo = 0, hi = 0;
+                if (i < mr) {
+                    const int8_t* a = A + (ptrdiff_t)(ir + i) * lda + p;
+                    lo = a[0];
+                    hi = (p + 1 < K) ? a[1] : 0;
+                }
+                Ap[i] = (int32_t)(uint16_t)lo | ((int32_t)(uint16_t)hi << 16);
+            }
+            Ap += LP_MR;
+        }
+    }
+}
+
+// Bp: por cada par de k, NR pares (b[k][j], b[k+1][j]) consecutivos en int16
+static void pack_B_i8(int kc, int nc, const int8_t* B, ptrdiff_t ldb, int K, int16_t* __restrict Bp) {
+    for (int jr = 0; jr < nc; jr += LP_NR) {
+        const int nr = min(LP_NR, nc - jr);
+        for (int p = 0; p < kc; p += 2) {
+            const int8_t* b0 = B + (ptrdiff_t)p * ldb + jr;
+            const int8_t* b1 = b0 + ldb;
+            const bool has1 = p + 1 < K;
+            for (int j = 0; j < LP_NR; ++j) {
+                Bp[2 * j]     = j < nr ? b0[j] : 0;
+                Bp[2 * j + 1] = (j < nr && has1) ? b1[j] : 0;
+            }
+            Bp += 2 * LP_NR;
+        }
+    }
+}
+
+// C[i][j] (+)= sa[i] * sb[j] * acc[i][j]
+static inline void store_tile_scaled(const int32_t* acc, int lda, const float* sa, const float* sb,
+                                     float* C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    for (int i = 0; i < mr; ++i) {
+        float* c = C + (ptrdiff_t)i * ldc;
+        for (int j = 0; j < nr; ++j) {
+            const float v = sa[i] * sb[j] * (float)acc[i * lda + j];
+            c[j] = accumulate ? c[j] + v : v;
+        }
+    }
+}
+
+static void micro_kernel_i8_generic(int kc2, const int32_t* __restrict Ap, const int16_t* __restrict Bp,
+                                    const float* sa, const float* sb,
+                                    float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    int32_t acc[LP_MR][LP_NR] = {};
+    for (int p = 0; p < kc2; ++p) {
+        for (int i = 0; i < LP_MR; ++i) {
+            const int32_t a = Ap[p * LP_MR + i];
+            const int32_t a0 = (int16_t)(a & 0xffff), a1 = (int16_t)(a >> 16);
+            for (int j = 0; j < LP_NR; ++j)
+                acc[i][j] += a0 * Bp[p * 2 * LP_NR + 2 * j] + a1 * Bp[p * 2 * LP_NR + 2 * j + 1];
+        }
+    }
+    store_tile_scaled(&acc[0][0], LP_NR, sa, sb, C, ldc, mr, nr, accumulate);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template <bool FP16>
+__attribute__((target("avx2,fma,f16c")))
+static void micro_kernel_h16_avx2(int kc, const float* __restrict Ap, const uint16_t* __restrict Bp,
+                                  float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    __m256 c[6][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; ++i) c[i][0] = c[i][1] = _mm256_setzero_ps();
+
+    for (int p = 0; p < kc; ++p) {
+        const __m128i lo = _mm_load_si128((const __m128i*)Bp);
+        const __m128i hi = _mm_load_si128((const __m128i*)(Bp + 8));
+        __m256 b0, b1;
+        if (FP16) {
+            b0 = _mm256_cvtph_ps(lo);
+            b1 = _mm256_cvtph_ps(hi);
+        } else {  // bf16: los 16 bits altos de un float
+            b0 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(lo), 16));
+            b1 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(hi), 16));
+        }
+#pragma GCC unroll 6
+        for (int i = 0; i < 6; ++i) {
+            const __m256 a = _mm256_broadcast_ss(Ap + i);
+            c[i][0] = _mm256_fmadd_ps(a, b0, c[i][0]);
+            c[i][1] = _mm256_fmadd_ps(a, b1, c[i][1]);
+        }
+        Ap += 6;
+        Bp += 16;
+    }
+    alignas(64) float tmp[6 * 16];
+    for (int i = 0; i < 6; ++i) {
+        _mm256_store_ps(tmp + i * 16, c[i][0]);
+        _mm256_store_ps(tmp + i * 16 + 8, c[i][1]);
+    }
+    store_tile(tmp, 16, C, ldc, mr, nr, accumulate);
+}
+
+__attribute__((target("avx2,fma")))
+static void micro_kernel_i8_avx2(int kc2, const int32_t* __restrict Ap, const int16_t* __restrict Bp,
+                                 const float* sa, const float* sb,
+                                 float* __restrict C, ptrdiff_t ldc, int mr, int nr, bool accumulate)
+{
+    __m256i c[6][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; ++i) c[i][0] = c[i][1] = _mm256_setzero_si256();
+
+    for (int p = 0; p < kc2; ++p) {
+        // 16 columnas x 2 k en int16 = 2 registros; madd suma a_k*b_k + a_k1*b_k1 por columna
+        const __m256i b0 = _mm256_load_si256((const __m256i*)Bp);
+        const __m256i b1 = _mm256_load_si256((const __m256i*)(Bp + 16));
+#pragma GCC unroll 6
+        for (int i = 0; i < 6; ++i) {
+            const __m256i a = _mm256_set1_epi32(Ap[i]);
+            c[i][0] = _mm256_add_epi32(c[i][0], _mm256_madd_epi16(a, b0));
+            c[i][1] = _mm256_add_epi32(c[i][1], _mm256_madd_epi16(a, b1));
+        }
+        Ap += 6;
+        Bp += 32;
+    }
+    alignas(64) int32_t tmp[6 * 16];
+    for (int i = 0; i < 6; ++i) {
+        _mm256_store_si256((__m256i*)(tmp + i * 16), c[i][0]);
+        _mm256_store_si256((__m256i*)(tmp + i * 16 + 8), c[i][1]);
+    }
+    store_tile_scaled(tmp, 16, sa, sb, C, ldc, mr, nr, accumulate);
+}
+#endif
+
+static bool cpu_has_avx2_fma(bool need_f16c = false) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+           (!need_f16c || __builtin_cpu_supports("f16c"));
+#else
+    (void)need_f16c;
+    return false;
+#endif
+}
+
+// Tile [i0, i0+m) x [j0, j0+n) de C = A_q * B_q, con el mismo esquema de lazos que gemm_blocked.
+static void gemm_lowprec_tile(const LowPrecMatrix& A, const LowPrecMatrix& B, float* C, ptrdiff_t ldc,
+                              int i0, int m, int j0, int n, const BlockParams& bp)
+{
+    const int K = A.cols;
+    const bool avx2 = cpu_has_avx2_fma(A.prec != LowPrec::INT8);
+    const int KC = max(2, bp.KC - bp.KC % 2), MC = max(LP_MR, bp.MC - bp.MC % LP_MR);
+    const int NC = max(LP_NR, bp.NC - bp.NC % LP_NR);
+
+    thread_local avec<float> Apf;
+    thread_local avec<uint16_t> Bph;
+    thread_local avec<int32_t> Api;
+    thread_local avec<int16_t> Bpi;
+    const size_t need_a = (size_t)(MC + LP_MR) * (KC + 2), need_b = (size_t)(NC + LP_NR) * (KC + 2);
+
+    if (A.prec == LowPrec::INT8) {
+        if (Api.size() < need_a / 2 + LP_MR) Api.resize(need_a / 2 + LP_MR);
+        if (Bpi.size() < need_b) Bpi.resize(need_b);
+    } else {
+        if (Apf.size() < need_a) Apf.resize(need_a);
+        if (Bph.size() < need_b) Bph.resize(need_b);
+    }
+
+    for (int jc = 0; jc < n; jc += NC) {
+        const int nc = min(NC, n - jc);
+        for (int pc = 0; pc < K; pc += KC) {
+            const int kc = min(KC, K - pc);
+            const int kc2 = (kc + 1) / 2;
+            if (A.prec == LowPrec::INT8)
+                pack_B_i8(kc, nc, B.q8.data() + (size_t)pc * B.cols + j0 + jc, B.cols, K - pc, Bpi.data());
+            else
+                pack_B_h16(kc, nc, B.h16.data() + (size_t)pc * B.cols + j0 + jc, B.cols, Bph.data());
+
+            for (int ic = 0; ic < m; ic += MC) {
+                const int mc = min(MC, m - ic);
+                const size_t arow = (size_t)(i0 + ic) * K + pc;
+                if (A.prec == LowPrec::INT8) pack_A_i8(mc, kc, A.q8.data() + arow, K, K - pc, Api.data());
+                else if (A.prec == LowPrec::FP16) pack_A_h16<true>(mc, kc, A.h16.data() + arow, K, Apf.data());
+                else pack_A_h16<false>(mc, kc, A.h16.data() + arow, K, Apf.data());
+
+                for (int jr = 0; jr < nc; jr += LP_NR) {
+                    for (int ir = 0; ir < mc; ir += LP_MR) {
+                        float* c = C + (ptrdiff_t)(i0 + ic + ir) * ldc + j0 + jc + jr;
+                        const int mr = min(LP_MR, mc - ir), nr = min(LP_NR, nc - jr);
+                        const bool acc = pc > 0;
+                        if (A.prec == LowPrec::INT8) {
+                            const int32_t* ap = Api.data() + (size_t)ir * kc2;
+                            const int16_t* bpn = Bpi.data() + (size_t)jr * 2 * kc2;
+                            const float* sa = A.scale.data() + i0 + ic + ir;
+                            const float* sb = B.scale.data() + j0 + jc + jr;
+#if defined(__x86_64__) || defined(__i386__)
+                            if (avx2) { micro_kernel_i8_avx2(kc2, ap, bpn, sa, sb, c, ldc, mr, nr, acc); continue; }
+#endif
+                            micro_kernel_i8_generic(kc2, ap, bpn, sa, sb, c, ldc, mr, nr, acc);
+                        } else {
+                            const float* ap = Apf.data() + (size_t)ir * kc;
+                            const uint16_t* bpn = Bph.data() + (size_t)jr * kc;
+                            const bool fp16 = A.prec == LowPrec::FP16;
+#if defined(__x86_64__) || defined(__i386__)
+                            if (avx2) {
+                                if (fp16) micro_kernel_h16_avx2<true>(kc, ap, bpn, c, ldc, mr, nr, acc);
+                                else      micro_kernel_h16_avx2<false>(kc, ap, bpn, c, ldc, mr, nr, acc);
+                                continue;
+                            }
+#endif
+                            if (fp16) micro_kernel_h16_generic<true>(kc, ap, bpn, c, ldc, mr, nr, acc);
+                            else      micro_kernel_h16_generic<false>(kc, ap, bpn, c, ldc, mr, nr, acc);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// C (M x N, fp32) = A_q (M x K) * B_q (K x N) en paralelo; devuelve la sumatoria.
+double matmul_lowprec_sum(Matrix& C, const LowPrecMatrix& A, const LowPrecMatrix& B, int num_threads) {
+    const int M = A.rows, N = B.cols;
+    return run_tiles_parallel(M, N, num_threads, [&](const Tile& tl) {
+        const int m = tl.i1 - tl.i0, n = tl.j1 - tl.j0;
+        gemm_lowprec_tile(A, B, C.data(), N, tl.i0, m, tl.j0, n, g_blk);
+        return tile_sum(C.data() + (size_t)tl.i0 * N + tl.j0, m, n, N);
+    });
+}
+
+static double gflops(int M, int K, int N, double millis) {
+    return millis > 0.0 ? 2.0 * M * (double)K * N / (millis * 1e6) : 0.0;
+}
+
+static double gflops(int N, double millis) { return gflops(N, N, N, millis); }
+
+// Valores pseudoaleatorios en [-1, 1) que dependen solo de (semilla, índice):
+// se pueden generar en paralelo con first touch y son reproducibles.
+static inline float hashed_value(uint64_t seed, uint64_t idx) {
+    uint64_t z = seed * 0x9e3779b97f4a7c15ULL + idx + 0x632be59bd9b4e019ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (float)((z >> 40) * (1.0 / (1ULL << 24))) * 2.0f - 1.0f;
+}
+
+void first_touch_fill_random(Matrix& X, int rows, int cols, uint64_t seed, int num_threads) {
+    num_threads = max(1, min(num_threads, rows));
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        auto [r0, r1] = owned_rows(rows, num_threads, t);
+        for (size_t i = (size_t)r0 * cols; i < (size_t)r1 * cols; ++i) X[i] = hashed_value(seed, i);
+    });
+}
+
+// ----------------- VERIFICACIÓN DE FREIVALDS -----------------
+// Comprueba C = A·B en O(R·(MK + KN + MN)) comparando A(B·r) con C·r para R
+// vectores aleatorios r ∈ {-1, +1}^N. Si C está mal, cada ronda lo deja pasar con
+// probabilidad <= 1/2, así que R = ceil(log2(1/p)) rondas dan error < p.
+//
+// En punto flotante la fila i se acepta si |A(Br) - Cr|_i <= tol_i. El modelo
+// usado es el probabilístico de redondeo: error por elemento ~ sqrt(K)·u·(|A||B|)_ij.
+// Como los N errores entran con signo aleatorio, queda
+// tol_i = τ · sqrt(K) · u · (|A| (|B| 1))_i / sqrt(N).
+// τ = 8 por defecto (--tolerancia).
+struct FreivaldsResult {
+    int rounds = 0;
+    bool ok = true;
+    int bad_row = -1;        // primera fila fuera de tolerancia
+    double worst_ratio = 0;  // max |A(Br) - Cr|_i / tol_i
+    double millis = 0;
+};
+
+static int freivalds_rounds(double p_error) {
+    p_error = min(0.5, max(p_error, 1e-300));
+    return max(1, (int)ceil(log2(1.0 / p_error)));
+}
+
+// acc[q] += sum_j x[j] * V[j*8 + q] (8 rondas a la vez, acumulando en double)
+static inline void freivalds_dot8(const float* x, const double* V, int n, double* acc) {
+    double a[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int j = 0; j < n; ++j) {
+        const double xj = x[j];
+        for (int q = 0; q < 8; ++q) a[q] += xj * V[(size_t)j * 8 + q];
+    }
+    for (int q = 0; q < 8; ++q) acc[q] += a[q];
+}
+
+static FreivaldsResult freivalds_verify(const float* A, const float* B, const float* C, int M, int K, int N,
+                                        double p_error, int num_threads, uint64_t seed, double tau = 8.0) {
+    FreivaldsResult res;
+    auto t0 = Clock::now();
+    const int R = res.rounds = freivalds_rounds(p_error);
+    const int groups = (R + 7) / 8;  // rondas en grupos de 8 (las que sobran valen 0)
+    num_threads = max(1, num_threads);
+    ThreadPool& pool = ThreadPool::instance();
+
+    // Signos por grupo: S[g][j][q] = r_{8g+q}(j)
+    vector<double> S((size_t)groups * N * 8, 0.0);
+    pool.run(num_threads, [&](int t) {
+        auto [j0, j1] = owned_rows(N, num_threads, t);
+        for (int r = 0; r < R; ++r)
+            for (int j = j0; j < j1; ++j)
+                S[((size_t)(r / 8) * N + j) * 8 + r % 8] = hashed_value(seed + r, j) < 0.0f ? -1.0 : 1.0;
+    });
+
+    // Y = B·r por grupo (Y[g][k][q]) y u = |B|·1, en una sola pasada por B
+    vector<double> Y((size_t)groups * K * 8), u(K);
+    pool.run(num_threads, [&](int t) {
+        auto [k0, k1] = owned_rows(K, num_threads, t);
+        for (int k = k0; k < k1; ++k) {
+            const float* b = B + (size_t)k * N;
+            double a = 0.0;
+            for (int j = 0; j < N; ++j) a += fabs(b[j]);
+            u[k] = a;
+            for (int g = 0; g < groups; ++g) {
+                double* y = Y.data() + ((size_t)g * K + k) * 8;
+                fill(y, y + 8, 0.0);
+                freivalds_dot8(b, S.data() + (size_t)g * N * 8, N, y);
+            }
+        }
+    });
+
+    // Por fila: A(Br), C·r y la cota |A|u
+    const double unit = numeric_limits<float>::epsilon() / 2;
+    const double scale = tau * sqrt((double)K) * unit / sqrt((double)max(1, N));
+    vector<double> worst(num_threads, 0.0);
+    vector<int> bad(num_threads, -1);
+    pool.run(num_threads, [&](int t) {
+        auto [i0, i1] = owned_rows(M, num_threads, t);
+        vector<double> ay((size_t)groups * 8), cs((size_t)groups * 8);
+        for (int i = i0; i < i1; ++i) {
+            const float* a = A + (size_t)i * K;
+            const float* c = C + (size_t)i * N;
+            double bound = 0.0;
+            for (int k = 0; k < K; ++k) bound += fabs((double)a[k]) * u[k];
+            fill(ay.begin(), ay.end(), 0.0);
+            fill(cs.begin(), cs.end(), 0.0);
+            for (int g = 0; g < groups; ++g) {
+                freivalds_dot8(a, Y.data() + (size_t)g * K * 8, K, ay.data() + g * 8);
+                freivalds_dot8(c, S.data() + (size_t)g * N * 8, N, cs.data() + g * 8);
+            }
+            const double tol = scale * bound + 1e-30;
+            for (int r = 0; r < R; ++r) {
+                const double ratio = fabs(ay[r] - cs[r]) / tol;
+                if (!(ratio <= 1.0) && bad[t] < 0) bad[t] = i;  // también atrapa NaN
+                worst[t] = max(worst[t], isnan(ratio) ? INFINITY : ratio);
+            }
+        }
+    });
+    for (int t = 0; t < num_threads; ++t) {
+        res.worst_ratio = max(res.worst_ratio, worst[t]);
+        if (bad[t] >= 0 && (res.bad_row < 0 || bad[t] < res.bad_row)) res.bad_row = bad[t];
+    }
+    res.ok = res.bad_row < 0;
+    res.millis = chrono::duration_cast<ms>(Clock::now() - t0).count();
+    return res;
+}
+
+static void print_freivalds(const FreivaldsResult& f, double p_error) {
+    cout << "Freivalds: " << f.rounds << " rondas (P[error no detectado] < " << scientific << setprecision(1)
+         << p_error << fixed << setprecision(6) << ")  " << f.millis << " ms  max residuo/tolerancia="
+         << f.worst_ratio << "  -> " << (f.ok ? "OK" : "FALLA en fila " + to_string(f.bad_row)) << "\n";
+}
+
+// ----------------- MATRICES DISPERSAS: CSR / BSR (SpMM y SpMV) -----------------
+// Con más del ~90% de ceros conviene guardar sólo los no nulos: memoria y tiempo
+// pasan a escalar con nnz en lugar de M*K. Las filas se reparten entre hilos por
+// cantidad de no nulos (no por cantidad de filas), así una fila densa no deja
+// a un solo hilo con casi todo el trabajo.
+
+static constexpr double kSparseDensityThreshold = 0.10;  // por debajo, camino disperso
+
+struct CsrMatrix {
+    int rows = 0, cols = 0;
+    vector<int64_t> row_ptr;  // rows + 1
+    vector<int> col_idx;      // nnz
+    vector<float> val;        // nnz
+    int64_t nnz() const { return row_ptr.empty() ? 0 : row_ptr.back(); }
+    size_t bytes() const {
+        return row_ptr.size() * sizeof(int64_t) + col_idx.size() * sizeof(int) + val.size() * sizeof(float);
+    }
+};
+
+// Bloques densos bs x bs: un índice por bloque y accesos a B de bs filas seguidas
+struct BsrMatrix {
+    int rows = 0, cols = 0, bs = 1;
+    vector<int64_t> block_ptr;  // filas de bloques + 1
+    vector<int> block_col;      // columna (en bloques) de cada bloque
+    vector<float> val;          // bs*bs por bloque, fila-mayor
+    int64_t blocks() const { return block_ptr.empty() ? 0 : block_ptr.back(); }
+    size_t bytes() const {
+        return block_ptr.size() * sizeof(int64_t) + block_col.size() * sizeof(int) + val.size() * sizeof(float);
+    }
+};
+
+static int64_t count_nonzeros(const Matrix& X, int rows, int cols, int num_threads) {
+    num_threads = max(1, min(num_threads, rows));
+    vector<int64_t> partial(num_threads, 0);
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        auto [r0, r1] = owned_rows(rows, num_threads, t);
+        int64_t c = 0;
+        for (size_t i = (size_t)r0 * cols; i < (size_t)r1 * cols; ++i) c += X[i] != 0.0f;
+        partial[t] = c;
+    });
+    return accumulate(partial.begin(), partial.end(), (int64_t)0);
+}
+
+static CsrMatrix csr_from_dense(const Matrix& X, int rows, int cols) {
+    CsrMatrix A;
+    A.rows = rows;
+    A.cols = cols;
+    A.row_ptr.assign(rows + 1, 0);
+    for (int i = 0; i < rows; ++i) {
+        const float* x = X.data() + (size_t)i * cols;
+        for (int j = 0; j < cols; ++j) {
+            if (x[j] == 0.0f) continue;
+            A.col_idx.push_back(j);
+            A.val.push_back(x[j]);
+        }
+        A.row_ptr[i + 1] = (int64_t)A.val.size();
+    }
+    return A;
+}
+
+static Matrix dense_from_csr(const CsrMatrix& A) {
+    Matrix X((size_t)A.rows * A.cols);
+    fill(X.begin(), X.end(), 0.0f);
+    for (int i = 0; i < A.rows; ++i)
+        for (int64_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p)
+            X[(size_t)i * A.cols + A.col_idx[p]] = A.val[p];
+    return X;
+}
+
+static BsrMatrix bsr_from_csr(const CsrMatrix& A, int bs) {
+    BsrMatrix R;
+    R.rows = A.rows;
+    R.cols = A.cols;
+    R.bs = bs;
+    const int brows = (A.rows + bs - 1) / bs;
+    const int bcols = (A.cols + bs - 1) / bs;
+    R.block_ptr.assign(brows + 1, 0);
+    vector<int> slot(bcols, -1);  // posición del bloque en la fila de bloques actual
+    for (int bi = 0; bi < brows; ++bi) {
+        const int64_t first = (int64_t)R.block_col.size();
+        const int r_end = min(A.rows, (bi + 1) * bs);
+        for (int i = bi * bs; i < r_end; ++i)
+            for (int64_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p) {
+                const int bj = A.col_idx[p] / bs;
+                if (slot[bj] < 0) {
+                    slot[bj] = (int)(R.block_col.size() - first);
+                    R.block_col.push_back(bj);
+                    R.val.resize(R.val.size() + (size_t)bs * bs, 0.0f);
+                }
+                float* blk = R.val.data() + (size_t)(first + slot[bj]) * bs * bs;
+                blk[(i - bi * bs) * bs + (A.col_idx[p] - bj * bs)] = A.val[p];
+            }
+        for (int64_t q = first; q < (int64_t)R.block_col.size(); ++q) slot[R.block_col[q]] = -1;
+        R.block_ptr[bi + 1] = (int64_t)R.block_col.size();
+    }
+    return R;
+}
+
+// Genera directamente en CSR (sin pasar por la densa): nnz ~ density*rows*cols,
+// en bloques bs x bs. Con skewed, el primer 10% de las filas lleva la mitad de
+// los no nulos (caso típico en el que repartir por filas desbalancea).
+static CsrMatrix random_sparse_csr(int rows, int cols, double density, int bs, bool skewed, uint64_t seed) {
+    const int brows = (rows + bs - 1) / bs, bcols = (cols + bs - 1) / bs;
+    const int heavy = skewed ? max(1, brows / 10) : 0;
+    mt19937_64 rng(seed);
+    vector<vector<int>> picked(brows);
+    for (int bi = 0; bi < brows; ++bi) {
+        double d = density;
+        if (skewed) d = bi < heavy ? density * 0.5 * brows / heavy : density * 0.5 * brows / max(1, brows - heavy);
+        const int want = (int)min<double>(bcols, llround(d * bcols));
+        uniform_int_distribution<int> col(0, bcols - 1);
+        vector<int>& v = picked[bi];
+        for (int k = 0; k < want; ++k) v.push_back(col(rng));
+        sort(v.begin(), v.end());
+        v.erase(unique(v.begin(), v.end()), v.end());
+    }
+
+    CsrMatrix A;
+    A.rows = rows;
+    A.cols = cols;
+    A.row_ptr.assign(rows + 1, 0);
+    for (int i = 0; i < rows; ++i) {
+        for (int bj : picked[i / bs])
+            for (int j = bj * bs; j < min(cols, (bj + 1) * bs); ++j) {
+                A.col_idx.push_back(j);
+                A.val.push_back(hashed_value(seed, (uint64_t)i * cols + j));
+            }
+        A.row_ptr[i + 1] = (int64_t)A.val.size();
+    }
+    return A;
+}
+
+// Cortes [bounds[t], bounds[t+1]) de filas con costo parejo; el costo de las
+// filas 0..i-1 es ptr[i] + i (no nulos más un costo fijo por fila)
+static vector<int> nnz_partition(const vector<int64_t>& ptr, int parts) {
+    const int rows = (int)ptr.size() - 1;
+    const double total = (double)ptr[rows] + rows;
+    vector<int> bounds(parts + 1, rows);
+    bounds[0] = 0;
+    for (int t = 1; t < parts; ++t) {
+        const double target = total * t / parts;
+        int lo = bounds[t - 1], hi = rows;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if ((double)ptr[mid] + mid < target) lo = mid + 1;
+            else hi = mid;
+        }
+        bounds[t] = lo;
+    }
+    return bounds;
+}
+
+// Máximo / promedio de no nulos por hilo (1.0 = perfecto)
+static double partition_imbalance(const vector<int64_t>& ptr, const vector<int>& bounds) {
+    const int parts = (int)bounds.size() - 1;
+    int64_t worst = 0;
+    for (int t = 0; t < parts; ++t) worst = max(worst, ptr[bounds[t + 1]] - ptr[bounds[t]]);
+    return ptr.back() > 0 ? (double)worst * parts / ptr.back() : 1.0;
+}
+
+// C (M x N) = A_csr (M x K) * B (K x N denso); devuelve la sumatoria de C.
+// Las columnas de C se recorren en franjas para que la fila parcial quede en L1.
+double spmm_csr_sum(const CsrMatrix& A, const float* B, int N, float* C, int num_threads) {
+    constexpr int NB = 2048;
+    num_threads = max(1, min(num_threads, A.rows));
+    const vector<int> bounds = nnz_partition(A.row_ptr, num_threads);
+    vector<double> partial(num_threads, 0.0);
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        double local_sum = 0.0;
+        for (int i = bounds[t]; i < bounds[t + 1]; ++i) {
+            float* __restrict c_row = C + (size_t)i * N;
+            for (int j0 = 0; j0 < N; j0 += NB) {
+                const int j1 = min(N, j0 + NB);
+                for (int j = j0; j < j1; ++j) c_row[j] = 0.0f;
+                for (int64_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p) {
+                    const float a = A.val[p];
+                    const float* __restrict b_row = B + (size_t)A.col_idx[p] * N;
+                    for (int j = j0; j < j1; ++j) c_row[j] += a * b_row[j];
+                }
+            }
+            for (int j = 0; j < N; ++j) local_sum += c_row[j];
+        }
+        partial[t] = local_sum;
+    });
+    return accumulate(partial.begin(), partial.end(), 0.0);
+}
+
+double spmm_bsr_sum(const BsrMatrix& A, const float* B, int N, float* C, int num_threads) {
+    const int bs = A.bs;
+    const int brows = (int)A.block_ptr.size() - 1;
+    num_threads = max(1, min(num_threads, brows));
+    const vector<int> bounds = nnz_partition(A.block_ptr, num_threads);
+    vector<double> partial(num_threads, 0.0);
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        double local_sum = 0.0;
+        for (int bi = bounds[t]; bi < bounds[t + 1]; ++bi) {
+            const int r0 = bi * bs, r1 = min(A.rows, r0 + bs);
+            for (int i = r0; i < r1; ++i) fill(C + (size_t)i * N, C + (size_t)(i + 1) * N, 0.0f);
+            for (int64_t q = A.block_ptr[bi]; q < A.block_ptr[bi + 1]; ++q) {
+                const float* blk = A.val.data() + (size_t)q * bs * bs;
+                const int c0 = A.block_col[q] * bs, cn = min(bs, A.cols - c0);
+                for (int r = 0; r < r1 - r0; ++r) {
+                    float* __restrict c_row = C + (size_t)(r0 + r) * N;
+                    for (int c = 0; c < cn; ++c) {
+                        const float a = blk[r * bs + c];
+                        if (a == 0.0f) continue;
+                        const float* __restrict b_row = B + (size_t)(c0 + c) * N;
+                        for (int j = 0; j < N; ++j) c_row[j] += a * b_row[j];
+                    }
+                }
+            }
+            for (int i = r0; i < r1; ++i) local_sum += tile_sum(C + (size_t)i * N, 1, N, N);
+        }
+        partial[t] = local_sum;
+    });
+    return accumulate(partial.begin(), partial.end(), 0.0);
+}
+
+// y = A_csr * x; devuelve la sumatoria de y
+double spmv_csr_sum(const CsrMatrix& A, const float* x, float* y, int num_threads) {
+    num_threads = max(1, min(num_threads, A.rows));
+    const vector<int> bounds = nnz_partition(A.row_ptr, num_threads);
+    vector<double> partial(num_threads, 0.0);
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        double local_sum = 0.0;
+        for (int i = bounds[t]; i < bounds[t + 1]; ++i) {
+            float acc = 0.0f;
+            for (int64_t p = A.row_ptr[i]; p < A.row_ptr[i + 1]; ++p) acc += A.val[p] * x[A.col_idx[p]];
+            y[i] = acc;
+            local_sum += acc;
+        }
+        partial[t] = local_sum;
+    });
+    return accumulate(partial.begin(), partial.end(), 0.0);
+}
+
+// Elige el camino según la densidad de A: CSR si hay pocos no nulos, denso si no
+double matmul_auto_sum(Matrix& C, const Matrix& A, const Matrix& B, int M, int K, int N,
+                       int num_threads, bool* used_sparse = nullptr,
+                       double threshold = kSparseDensityThreshold)
+{
+    const double density = (double)count_nonzeros(A, M, K, num_threads) / max(1.0, (double)M * K);
+    const bool sparse = density < threshold;
+    if (used_sparse) *used_sparse = sparse;
+    if (!sparse) return matmul_parallel_sum(C, A, B, M, K, N, num_threads);
+    const CsrMatrix As = csr_from_dense(A, M, K);
+    return spmm_csr_sum(As, B.data(), N, C.data(), num_threads);
+}
+
+// ----------------- GEMM FUERA DE MEMORIA (A, B y C en disco) -----------------
+// Para matrices que no entran en RAM: A (M x K), B (K x N) y C (M x N) son
+// archivos float32 fila-mayor. Se recorren tiles de C; por cada uno se
+// acumulan los productos A(i,k)*B(k,j) sobre k. Un único hilo de E/S
+// persistente (cola FIFO) trae el par (A,B) del paso siguiente a un segundo
+// buffer mientras se calcula el actual, y escribe los tiles de C terminados
+// desde otro buffer.
+// Recorrido en serpentina (j y k alternan de sentido) para reusar en el paso
+// siguiente el último tile cargado; si tk == K, el tile de A se reusa en toda
+// la banda de filas.
+
+struct OocPlan { int tm, tn, tk; };
+
+struct OocStats {
+    double read_bytes = 0, write_bytes = 0;
+    double io_ms = 0, wait_ms = 0, compute_ms = 0, total_ms = 0;
+    long tiles_read = 0, tiles_reused = 0;
+};
+
+// Bytes de los buffers de empaquetado (thread_local de gemm_blocked) de T hilos
+static size_t ooc_pack_bytes(int num_threads) {
+    const size_t per_thread = ((size_t)(g_blk.MC + g_kernel.MR) * g_blk.KC +
+                               (size_t)(g_blk.NC + g_kernel.NR) * g_blk.KC) * sizeof(float);
+    return per_thread * (size_t)max(1, num_threads);
+}
+
+static constexpr int kOocMinTile = 16;
+
+// Tiles tm x tk, tk x tn, tm x tn con 2 buffers de cada uno (A y B del paso en
+// curso y del siguiente, C en cálculo y en escritura) dentro de budget bytes,
+// descontando los buffers de empaquetado. Si no alcanza ni para tiles de
+// kOocMinTile lanza runtime_error con el mínimo necesario.
+static OocPlan ooc_plan(int M, int K, int N, size_t budget, int num_threads) {
+    const size_t pack = ooc_pack_bytes(num_threads);
+    const int tmin = max(1, min({kOocMinTile, M, K, N}));
+    const size_t min_budget = pack + 2 * 3 * (size_t)tmin * tmin * sizeof(float);
+    if (budget < min_budget)
+        throw runtime_error("--memoria insuficiente: hace falta al menos " +
+                            to_string((min_budget + (1 << 20) - 1) >> 20) + " MiB (" +
+                            to_string(pack >> 10) + " KiB de empaquetado para " +
+                            to_string(max(1, num_threads)) + " hilos)");
+    const double floats = (double)(budget - pack) / sizeof(float) / 2.0;  // por juego de buffers
+    OocPlan p;
+    // Tiles cuadrados t x t: 3t^2 floats por juego
+    int t = max(tmin, (int)sqrt(floats / 3.0));
+    p.tk = min(K, t);
+    // Con K chico sobra memoria: agrandar tm = tn con t^2 + 2*t*tk <= floats
+    t = (int)(-p.tk + sqrt((double)p.tk * p.tk + floats));
+    p.tm = max(1, min(M, t));
+    p.tn = max(1, min(N, (int)((floats - (double)p.tm * p.tk) / (p.tm + p.tk))));
+    // Partes parejas (evita un último tile de pocas filas/columnas)
+    auto even = [](int dim, int t) { const int parts = (dim + t - 1) / t; return (dim + parts - 1) / parts; };
+    p.tm = even(M, p.tm);
+    p.tn = even(N, p.tn);
+    p.tk = even(K, p.tk);
+    return p;
+}
+
+// Hilo de E/S persistente: ejecuta las tareas en orden y devuelve un future por
+// cada una (las excepciones de pread/pwrite llegan al que hace get())
+class IoQueue {
+public:
+    IoQueue() : th([this] { loop(); }) {}
+    ~IoQueue() {
+        {
+            lock_guard<mutex> lk(mtx);
+            stop = true;
+        }
+        cv.notify_one();
+        th.join();
+    }
+
+    future<void> submit(function<void()> fn) {
+        packaged_task<void()> task(move(fn));
+        future<void> f = task.get_future();
+        {
+            lock_guard<mutex> lk(mtx);
+            q.push_back(move(task));
+        }
+        cv.notify_one();
+        return f;
+    }
+
+private:
+    void loop() {
+        while (true) {
+            packaged_task<void()> task;
+            {
+                unique_lock<mutex> lk(mtx);
+                cv.wait(lk, [&] { return stop || !q.empty(); });
+                if (q.empty()) return;
+                task = move(q.front());
+                q.pop_front();
+            }
+            task();
+        }
+    }
+
+    mutex mtx;
+    condition_variable cv;
+    deque<packaged_task<void()>> q;
+    bool stop = false;
+    thread th;  // último: arranca con la cola ya construida
+};
+
+static void pread_all(int fd, void* buf, size_t bytes, off_t off) {
+    char* p = (char*)buf;
+    while (bytes > 0) {
+        const ssize_t r = pread(fd, p, bytes, off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) throw runtime_error(string("pread: ") + (r == 0 ? "fin de archivo" : strerror(errno)));
+        p += r; bytes -= r; off += r;
+    }
+}
+
+static void pwrite_all(int fd, const void* buf, size_t bytes, off_t off) {
+    const char* p = (const char*)buf;
+    while (bytes > 0) {
+        const ssize_t r = pwrite(fd, p, bytes, off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) throw runtime_error(string("pwrite: ") + strerror(errno));
+        p += r; bytes -= r; off += r;
+    }
+}
+
+// Sub-bloque [r0, r0+rows) x [c0, c0+cols) de una matriz fila-mayor de ld columnas
+static void read_tile(int fd, int ld, int r0, int c0, int rows, int cols, float* dst) {
+    for (int i = 0; i < rows; ++i)
+        pread_all(fd, dst + (size_t)i * cols, (size_t)cols * sizeof(float),
+                  ((off_t)(r0 + i) * ld + c0) * (off_t)sizeof(float));
+}
+
+static void write_tile(int fd, int ld, int r0, int c0, int rows, int cols, const float* src) {
+    for (int i = 0; i < rows; ++i)
+        pwrite_all(fd, src + (size_t)i * cols, (size_t)cols * sizeof(float),
+                   ((off_t)(r0 + i) * ld + c0) * (off_t)sizeof(float));
+}
+
+// Escribe un archivo rows x cols por franjas (sin materializar la matriz)
+template <class ValueFn>
+static void write_matrix_file(const string& path, int rows, int cols, ValueFn value) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw runtime_error("no se pudo crear " + path + ": " + strerror(errno));
+    const int band = max(1, (int)((16u << 20) / sizeof(float) / max(1, cols)));
+    vector<float> buf((size_t)band * cols);
+    for (int r0 = 0; r0 < rows; r0 += band) {
+        const int r1 = min(rows, r0 + band);
+        for (int i = r0; i < r1; ++i)
+            for (int j = 0; j < cols; ++j) buf[(size_t)(i - r0) * cols + j] = value(i, j);
+        pwrite_all(fd, buf.data(), (size_t)(r1 - r0) * cols * sizeof(float), (off_t)r0 * cols * (off_t)sizeof(float));
+    }
+    close(fd);
+}
+
+// C = A*B con los tres operandos en archivos; devuelve la sumatoria de C.
+double gemm_out_of_core(const string& path_a, const string& path_b, const string& path_c,
+                        int M, int K, int N, size_t budget, int num_threads, OocStats& st)
+{
+    const OocPlan p = ooc_plan(M, K, N, budget, num_threads);
+    const int fa = open(path_a.c_str(), O_RDONLY), fb = open(path_b.c_str(), O_RDONLY);
+    const int fc = open(path_c.c_str(), O_WRONLY | O_CREAT, 0644);
+    // Antes de lanzar se cierran los que sí se abrieron (strerror antes de close)
+    auto fail = [&](const string& what) {
+        const string msg = what + strerror(errno);
+        for (int fd : {fa, fb, fc}) if (fd >= 0) close(fd);
+        throw runtime_error(msg);
+    };
+    if (fa < 0 || fb < 0 || fc < 0) fail("no se pudieron abrir los archivos: ");
+    if (ftruncate(fc, (off_t)M * N * (off_t)sizeof(float)) != 0) fail("ftruncate: ");
+    posix_fadvise(fa, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fb, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Pasos (i, j, k) en serpentina
+    struct Step { int i0, j0, k0; };
+    vector<Step> steps;
+    bool j_fwd = true, k_fwd = true;
+    for (int i0 = 0; i0 < M; i0 += p.tm) {
+        vector<int> js;
+        for (int j0 = 0; j0 < N; j0 += p.tn) js.push_back(j0);
+        if (!j_fwd) reverse(js.begin(), js.end());
+        for (int j0 : js) {
+            vector<int> ks;
+            for (int k0 = 0; k0 < K; k0 += p.tk) ks.push_back(k0);
+            if (!k_fwd) reverse(ks.begin(), ks.end());
+            for (int k0 : ks) steps.push_back({i0, j0, k0});
+            k_fwd = !k_fwd;
+        }
+        j_fwd = !j_fwd;
+    }
+
+    // Dos buffers por operando; id = origen del tile cargado en cada uno
+    struct Slot { avec<float> buf; long long id = -1; };
+    Slot sa[2], sb[2];
+    for (int s = 0; s < 2; ++s) {
+        sa[s].buf.resize((size_t)p.tm * p.tk);
+        sb[s].buf.resize((size_t)p.tk * p.tn);
+    }
+    avec<float> cbuf[2] = {avec<float>((size_t)p.tm * p.tn), avec<float>((size_t)p.tm * p.tn)};
+    future<void> pending_write[2];
+
+    auto id_of = [](int r0, int c0) { return ((long long)r0 << 32) | (unsigned)c0; };
+    // Deja en cur_a/cur_b los slots con los tiles del paso s (sin tocar los del paso en curso)
+    auto load = [&](const Step& s, int busy_a, int busy_b, int& out_a, int& out_b, double& io_ms) {
+        const int rows = min(p.tm, M - s.i0), kk = min(p.tk, K - s.k0), cols = min(p.tn, N - s.j0);
+        auto t0 = Clock::now();
+        const long long ida = id_of(s.i0, s.k0), idb = id_of(s.k0, s.j0);
+        if (busy_a >= 0 && sa[busy_a].id == ida) out_a = busy_a;
+        else {
+            out_a = busy_a < 0 ? 0 : 1 - busy_a;
+            if (sa[out_a].id != ida) {
+                read_tile(fa, K, s.i0, s.k0, rows, kk, sa[out_a].buf.data());
+                sa[out_a].id = ida;
+                st.read_bytes += (double)rows * kk * sizeof(float);
+                ++st.tiles_read;
+            } else ++st.tiles_reused;
+        }
+        if (busy_b >= 0 && sb[busy_b].id == idb) out_b = busy_b;
+        else {
+            out_b = busy_b < 0 ? 0 : 1 - busy_b;
+            if (sb[out_b].id != idb) {
+                read_tile(fb, N, s.k0, s.j0, kk, cols, sb[out_b].buf.data());
+                sb[out_b].id = idb;
+                st.read_bytes += (double)kk * cols * sizeof(float);
+                ++st.tiles_read;
+            } else ++st.tiles_reused;
+        }
+        if (out_a == busy_a) ++st.tiles_reused;
+        if (out_b == busy_b) ++st.tiles_reused;
+        io_ms += chrono::duration_cast<ms>(Clock::now() - t0).count();
+    };
+
+    auto t_start = Clock::now();
+    double total = 0.0, read_ms = 0.0, write_ms = 0.0;
+    int cur_a = -1, cur_b = -1, next_a = -1, next_b = -1, cb = 0;
+    load(steps[0], -1, -1, cur_a, cur_b, read_ms);
+    // Después de todo lo que usan sus tareas: se destruye (y vacía su cola) antes
+    IoQueue io;
+
+    for (size_t s = 0; s < steps.size(); ++s) {
+        const Step& st_s = steps[s];
+        future<void> prefetch;
+        if (s + 1 < steps.size()) {
+            prefetch = io.submit([&, s, cur_a, cur_b] {
+                load(steps[s + 1], cur_a, cur_b, next_a, next_b, read_ms);
+            });
+        }
+
+        const int rows = min(p.tm, M - st_s.i0), kk = min(p.tk, K - st_s.k0), cols = min(p.tn, N - st_s.j0);
+        const bool first_k = s == 0 || steps[s - 1].i0 != st_s.i0 || steps[s - 1].j0 != st_s.j0;
+        const bool last_k = s + 1 == steps.size() || steps[s + 1].i0 != st_s.i0 || steps[s + 1].j0 != st_s.j0;
+        if (first_k && pending_write[cb].valid()) {  // el buffer de C todavía se está escribiendo
+            auto tw = Clock::now();
+            pending_write[cb].get();
+            st.wait_ms += chrono::duration_cast<ms>(Clock::now() - tw).count();
+        }
+
+        auto tc = Clock::now();
+        const float* a = sa[cur_a].buf.data();
+        const float* b = sb[cur_b].buf.data();
+        float* c = cbuf[cb].data();
+        const double sum = run_tiles_parallel(rows, cols, num_threads, [&](const Tile& tl) {
+            const int m = tl.i1 - tl.i0, n = tl.j1 - tl.j0;
+            float* ct = c + (size_t)tl.i0 * cols + tl.j0;
+            gemm_blocked(m, n, kk, a + (size_t)tl.i0 * kk, kk, 1, b + tl.j0, cols, 1, ct, cols,
+                         g_blk, g_kernel, !first_k);
+            return last_k ? tile_sum(ct, m, n, cols) : 0.0;
+        });
+        st.compute_ms += chrono::duration_cast<ms>(Clock::now() - tc).count();
+
+        if (last_k) {
+            total += sum;
+            const int wi = st_s.i0, wj = st_s.j0, wbuf = cb;
+            pending_write[cb] = io.submit([&, wi, wj, rows, cols, wbuf] {
+                auto tw = Clock::now();
+                write_tile(fc, N, wi, wj, rows, cols, cbuf[wbuf].data());
+                write_ms += chrono::duration_cast<ms>(Clock::now() - tw).count();
+                st.write_bytes += (double)rows * cols * sizeof(float);
+            });
+            cb = 1 - cb;
+        }
+
+        if (prefetch.valid()) {
+            auto tw = Clock::now();
+            prefetch.get();
+            st.wait_ms += chrono::duration_cast<ms>(Clock::now() - tw).count();
+            cur_a = next_a;
+            cur_b = next_b;
+        }
+    }
+    for (auto& w : pending_write) {
+        if (!w.valid()) continue;
+        auto tw = Clock::now();
+        w.get();
+        st.wait_ms += chrono::duration_cast<ms>(Clock::now() - tw).count();
+    }
+    st.total_ms = chrono::duration_cast<ms>(Clock::now() - t_start).count();
+    st.io_ms = read_ms + write_ms;
+    close(fa); close(fb); close(fc);
+    return total;
+}
+
+// ----------------- E/S DE MATRICES: BINARIO PROPIO Y .npy (mmap) -----------------
+// Formato propio (.mat): cabecera de 64 bytes y datos a partir del byte 64.
+//   0  "MATMUL01"   8  versión (u32)   12 tipo (u32: 0 = f32, 1 = f64)
+//   16 disposición (u32: 0 = fila-mayor, 1 = columna-mayor)   20 reservado
+//   24 filas (u64)  32 columnas (u64)  40 desplazamiento de los datos (u64)
+// .npy (versiones 1, 2 y 3): '<f4' o '<f8', fortran_order y shape 1D o 2D.
+// numpy ya rellena la cabecera a múltiplo de 64 y escribimos igual.
+//
+// Lectura: el archivo se mapea con mmap. Si es f32 fila-mayor (el caso común) los
+// kernels leen directo del mapeo, sin copia, y las páginas las trae cada hilo la
+// primera vez que toca su banda de filas. En cualquier otro caso se convierte en
+// paralelo a un Matrix fila-mayor f32.
+// Escritura: la cabecera se escribe primero, después ftruncate al tamaño final, y
+// cada hilo escribe su banda de filas con pwrite grandes.
+
+enum class FileDtype { F32, F64 };
+
+struct MatrixFileInfo {
+    int rows = 0, cols = 0;
+    FileDtype dtype = FileDtype::F32;
+    bool col_major = false;
+    size_t data_offset = 0;
+    bool npy = false;
+};
+
+static constexpr char kMatMagic[8] = {'M', 'A', 'T', 'M', 'U', 'L', '0', '1'};
+
+static bool ends_with(const string& s, const string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Cabecera .npy: "{'descr': '<f4', 'fortran_order': False, 'shape': (M, N), }"
+static MatrixFileInfo parse_npy_header(const string& h, size_t data_offset) {
+    MatrixFileInfo info;
+    info.npy = true;
+    info.data_offset = data_offset;
+    auto value_of = [&](const string& key) {
+        const size_t k = h.find("'" + key + "'");
+        if (k == string::npos) throw runtime_error(".npy sin '" + key + "'");
+        size_t v = h.find(':', k) + 1;
+        while (v < h.size() && h[v] == ' ') ++v;
+        return v;
+    };
+    size_t v = value_of("descr");
+    const string descr = h.substr(v + 1, h.find('\'', v + 1) - v - 1);
+    if (descr == "<f4" || descr == "=f4") info.dtype = FileDtype::F32;
+    else if (descr == "<f8" || descr == "=f8") info.dtype = FileDtype::F64;
+    else throw runtime_error("tipo .npy no soportado: " + descr + " (sólo <f4 y <f8)");
+    v = value_of("fortran_order");
+    info.col_major = h.compare(v, 4, "True") == 0;
+    v = value_of("shape");
+    vector<long long> dims;
+    for (size_t p = h.find('(', v) + 1; p < h.size() && h[p] != ')';) {
+        if (isdigit((unsigned char)h[p])) {
+            size_t used = 0;
+            dims.push_back(stoll(h.substr(p), &used));
+            p += used;
+        } else {
+            ++p;
+        }
+    }
+    if (dims.empty() || dims.size() > 2) throw runtime_error(".npy debe ser 1D o 2D");
+    if (dims.size() == 1) dims.insert(dims.begin(), 1);
+    if (dims[0] > INT_MAX || dims[1] > INT_MAX) throw runtime_error(".npy demasiado grande");
+    info.rows = (int)dims[0];
+    info.cols = (int)dims[1];
+    return info;
+}
+
+static MatrixFileInfo read_matrix_header(int fd, const string& path) {
+    char head[64] = {};
+    const ssize_t got = pread(fd, head, sizeof(head), 0);
+    if (got >= 10 && memcmp(head, "\x93NUMPY", 6) == 0) {
+        const int major = (unsigned char)head[6];
+        size_t hlen, pre;
+        if (major == 1) { hlen = (unsigned char)head[8] | ((unsigned char)head[9] << 8); pre = 10; }
+        else { uint32_t l; memcpy(&l, head + 8, 4); hlen = l; pre = 12; }
+        string h(hlen, '\0');
+        pread_all(fd, h.data(), hlen, (off_t)pre);
+        return parse_npy_header(h, pre + hlen);
+    }
+    if (got == 64 && memcmp(head, kMatMagic, 8) == 0) {
+        uint32_t version, dtype, layout;
+        uint64_t rows, cols, off;
+        memcpy(&version, head + 8, 4);
+        memcpy(&dtype, head + 12, 4);
+        memcpy(&layout, head + 16, 4);
+        memcpy(&rows, head + 24, 8);
+        memcpy(&cols, head + 32, 8);
+        memcpy(&off, head + 40, 8);
+        if (version != 1 || dtype > 1 || layout > 1 || rows > INT_MAX || cols > INT_MAX)
+            throw runtime_error(path + ": cabecera .mat inválida");
+        MatrixFileInfo info;
+        info.rows = (int)rows;
+        info.cols = (int)cols;
+        info.dtype = dtype ? FileDtype::F64 : FileDtype::F32;
+        info.col_major = layout == 1;
+        info.data_offset = off;
+        return info;
+    }
+    throw runtime_error(path + ": no es .npy ni .mat");
+}
+
+// Matriz leída de archivo: vista directa al mapeo (f32 fila-mayor) o copia convertida
+class MappedMatrix {
+public:
+    // Si algo falla después del open, el destructor no corre: se libera acá
+    MappedMatrix(const string& path, int num_threads) {
+        try {
+            load(path, num_threads);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+    ~MappedMatrix() { release(); }
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    const float* data() const { return view; }
+    int rows() const { return info.rows; }
+    int cols() const { return info.cols; }
+    bool zero_copy() const { return view != copy_.data(); }
+    const MatrixFileInfo& file() const { return info; }
+
+private:
+    void load(const string& path, int num_threads) {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("no se pudo abrir " + path + ": " + strerror(errno));
+        info = read_matrix_header(fd, path);
+        struct stat sb;
+        if (fstat(fd, &sb) != 0) throw runtime_error("fstat " + path + ": " + strerror(errno));
+        const size_t elem = info.dtype == FileDtype::F64 ? 8 : 4;
+        const size_t need = info.data_offset + (size_t)info.rows * info.cols * elem;
+        if ((size_t)sb.st_size < need) throw runtime_error(path + ": archivo truncado");
+        map_len = need;
+        map = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) throw runtime_error(string("mmap: ") + strerror(errno));
+        const char* base = (const char*)map + info.data_offset;
+        const int rows = info.rows, cols = info.cols;
+        num_threads = max(1, min(num_threads, max(1, rows)));
+
+        if (info.dtype == FileDtype::F32 && !info.col_major && info.data_offset % alignof(float) == 0) {
+            view = (const float*)base;
+            // Cada hilo trae sus páginas (las mismas filas que luego calcula)
+            madvise(map, map_len, MADV_WILLNEED);
+            ThreadPool::instance().run(num_threads, [&](int t) {
+                auto [r0, r1] = owned_rows(rows, num_threads, t);
+                volatile float sink = 0;
+                for (size_t i = (size_t)r0 * cols; i < (size_t)r1 * cols; i += 4096 / sizeof(float)) sink = sink + view[i];
+            });
+            return;
+        }
+        // Conversión paralela a f32 fila-mayor (first touch por bandas de filas)
+        copy_ = Matrix((size_t)rows * cols);
+        const bool f64 = info.dtype == FileDtype::F64, cm = info.col_major;
+        ThreadPool::instance().run(num_threads, [&](int t) {
+            auto [r0, r1] = owned_rows(rows, num_threads, t);
+            for (int i = r0; i < r1; ++i)
+                for (int j = 0; j < cols; ++j) {
+                    const size_t src = cm ? (size_t)j * rows + i : (size_t)i * cols + j;
+                    copy_[(size_t)i * cols + j] = f64 ? (float)((const double*)base)[src] : ((const float*)base)[src];
+                }
+        });
+        view = copy_.data();
+    }
+    void release() {
+        if (map && map != MAP_FAILED) munmap(map, map_len);
+        if (fd >= 0) close(fd);
+        map = nullptr;
+        fd = -1;
+    }
+
+    int fd = -1;
+    void* map = nullptr;
+    size_t map_len = 0;
+    MatrixFileInfo info;
+    Matrix copy_;
+    const float* view = nullptr;
+};
+
+// Cabecera de salida (f32 fila-mayor) según la extensión: .npy o .mat
+static string matrix_file_header(const string& path, int rows, int cols) {
+    if (ends_with(path, ".npy")) {
+        string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + to_string(rows) + ", " +
+                      to_string(cols) + "), }";
+        const size_t pre = 10, total = (pre + dict.size() + 1 + 63) / 64 * 64;
+        dict.append(total - pre - dict.size() - 1, ' ');
+        dict += '\n';
+        string h = "\x93NUMPY";
+        h += (char)1;
+        h += (char)0;
+        h += (char)(dict.size() & 0xff);
+        h += (char)(dict.size() >> 8);
+        return h + dict;
+    }
+    string h(64, '\0');
+    const uint32_t version = 1, dtype = 0, layout = 0;
+    const uint64_t r = rows, c = cols, off = 64;
+    memcpy(&h[0], kMatMagic, 8);
+    memcpy(&h[8], &version, 4);
+    memcpy(&h[12], &dtype, 4);
+    memcpy(&h[16], &layout, 4);
+    memcpy(&h[24], &r, 8);
+    memcpy(&h[32], &c, 8);
+    memcpy(&h[40], &off, 8);
+    return h;
+}
+
+// Guarda X (rows x cols, f32 fila-mayor): cada hilo escribe su banda de filas
+static void save_matrix(const string& path, const float* X, int rows, int cols, int num_threads) {
+    const string header = matrix_file_header(path, rows, cols);
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw runtime_error("no se pudo crear " + path + ": " + strerror(errno));
+    const off_t data_off = (off_t)header.size();
+    pwrite_all(fd, header.data(), header.size(), 0);
+    if (ftruncate(fd, data_off + (off_t)rows * cols * (off_t)sizeof(float)) != 0)
+        throw runtime_error(string("ftruncate: ") + strerror(errno));
+    num_threads = max(1, min(num_threads, max(1, rows)));
+    const size_t chunk = 64u << 20;
+    vector<string> errors(num_threads);
+    ThreadPool::instance().run(num_threads, [&](int t) {
+        auto [r0, r1] = owned_rows(rows, num_threads, t);
+        const char* p = (const char*)(X + (size_t)r0 * cols);
+        size_t bytes = (size_t)(r1 - r0) * cols * sizeof(float);
+        off_t off = data_off + (off_t)r0 * cols * (off_t)sizeof(float);
+        try {
+            while (bytes > 0) {
+                const size_t n = min(bytes, chunk);
+                pwrite_all(fd, p, n, off);
+                p += n; off += n; bytes -= n;
+            }
+        } catch (const exception& e) {
+            errors[t] = e.what();
+        }
+    });
+    close(fd);
+    for (const string& e : errors)
+        if (!e.empty()) throw runtime_error(path + ": " + e);
+}
+
+// ----------------- AUTO-AJUSTE (perfil persistente) -----------------
+// --modo=tunear detecta cachés y topología, busca micro-kernel, bloques
+// (MC, KC, NC), forma de los tiles paralelos y cantidad de hilos sobre tamaños
+// representativos, y guarda lo mejor en un archivo de perfil "clave=valor".
+// Al arrancar se carga ese perfil si la firma de la máquina coincide, así cada
+// generación de servidores usa su propia configuración.
+
+struct CacheLevel { int level; string type; long bytes; int shared_cpus; };
+
+struct MachineInfo {
+    string model;
+    int logical = 1, physical = 1, sockets = 1, numa_nodes = 1;
+    vector<CacheLevel> caches;
+    string signature() const {
+        ostringstream os;
+        os << model << "|" << logical << "c";
+        for (const auto& c : caches) if (c.type != "Instruction") os << "|L" << c.level << "=" << c.bytes / 1024 << "K";
+        return os.str();
+    }
+};
+
+static string read_first_line(const string& path) {
+    ifstream in(path);
+    string s;
+    getline(in, s);
+    return s;
+}
+
+// Cantidad de CPUs en una lista "0-3,8,10-11"
+static int cpu_list_count(const string& list) {
+    int n = 0;
+    stringstream ss(list);
+    for (string part; getline(ss, part, ',');) {
+        int a, b;
+        if (sscanf(part.c_str(), "%d-%d", &a, &b) == 2) n += b - a + 1;
+        else if (!part.empty()) ++n;
+    }
+    return n;
+}
+
+static MachineInfo detect_machine() {
+    MachineInfo m;
+    {
+        ifstream in("/proc/cpuinfo");
+        for (string line; getline(in, line);)
+            if (line.rfind("model name", 0) == 0) { m.model = line.substr(line.find(':') + 2); break; }
+        if (m.model.empty()) m.model = "desconocido";
+    }
+    m.logical = max(1, (int)allowed_cpus().size());
+    set<pair<int, int>> cores;
+    set<int> packages;
+    for (int cpu : allowed_cpus()) {
+        const string base = "/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/";
+        const string pkg = read_first_line(base + "physical_package_id"), core = read_first_line(base + "core_id");
+        if (pkg.empty() || core.empty()) continue;
+        cores.insert({stoi(pkg), stoi(core)});
+        packages.insert(stoi(pkg));
+    }
+    m.physical = cores.empty() ? m.logical : (int)cores.size();
+    m.sockets = max(1, (int)packages.size());
+    const string nodes = read_first_line("/sys/devices/system/node/online");
+    m.numa_nodes = nodes.empty() ? 1 : max(1, cpu_list_count(nodes));
+    for (int idx = 0;; ++idx) {
+        const string base = "/sys/devices/system/cpu/cpu0/cache/index" + to_string(idx) + "/";
+        const string level = read_first_line(base + "level");
+        if (level.empty()) break;
+        const string size = read_first_line(base + "size");
+        long bytes = atol(size.c_str());
+        if (size.find('K') != string::npos) bytes <<= 10;
+        else if (size.find('M') != string::npos) bytes <<= 20;
+        m.caches.push_back({stoi(level), read_first_line(base + "type"), bytes,
+                            cpu_list_count(read_first_line(base + "shared_cpu_list"))});
+    }
+    if (m.caches.empty()) {  // sin sysfs: lo que informe sysconf
+        m.caches.push_back({1, "Data", cache_bytes(_SC_LEVEL1_DCACHE_SIZE, 32 << 10), 1});
+        m.caches.push_back({2, "Unified", cache_bytes(_SC_LEVEL2_CACHE_SIZE, 1 << 20), 1});
+        m.caches.push_back({3, "Unified", cache_bytes(_SC_LEVEL3_CACHE_SIZE, 16 << 20), m.logical});
+    }
+    return m;
+}
+
+struct TuneProfile {
+    string signature, kernel;
+    BlockParams bp{};
+    int tile_m = 0, tile_n = 0;  // 0 = choose_tile_dims
+    int threads = 0;
+    double gflops = 0.0;
+};
+
+static string default_profile_path() {
+    if (const char* p = getenv("MATMUL_PERFIL")) return p;
+    const char* home = getenv("HOME");
+    return string(home ? home : ".") + "/.matmul_perfil";
+}
+
+static bool save_profile(const string& path, const TuneProfile& p) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "# Perfil de matmul generado con --modo=tunear\n"
+        << "firma=" << p.signature << "\n"
+        << "kernel=" << p.kernel << "\n"
+        << "MC=" << p.bp.MC << "\nKC=" << p.bp.KC << "\nNC=" << p.bp.NC << "\n"
+        << "tile_m=" << p.tile_m << "\ntile_n=" << p.tile_n << "\n"
+        << "hilos=" << p.threads << "\n"
+        << "gflops=" << p.gflops << "\n";
+    return (bool)out;
+}
+
+static bool load_profile(const string& path, TuneProfile& p) {
+    ifstream in(path);
+    if (!in) return false;
+    map<string, string> kv;
+    for (string line; getline(in, line);) {
+        if (line.empty() || line[0] == '#') continue;
+        const size_t eq = line.find('=');
+        if (eq != string::npos) kv[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    auto num = [&](const char* k) { return kv.count(k) ? atoi(kv[k].c_str()) : 0; };
+    p.signature = kv["firma"];
+    p.kernel = kv["kernel"];
+    p.bp = {num("MC"), num("KC"), num("NC")};
+    p.tile_m = num("tile_m");
+    p.tile_n = num("tile_n");
+    p.threads = num("hilos");
+    p.gflops = kv.count("gflops") ? atof(kv["gflops"].c_str()) : 0.0;
+    return !p.kernel.empty() && p.bp.MC > 0 && p.bp.KC > 0 && p.bp.NC > 0;
+}
+
+static bool find_micro_kernel(const string& name, MicroKernel& out) {
+    for (const auto& k : available_micro_kernels())
+        if (name == k.name) { out = k; return true; }
+    return false;
+}
+
+// Aplica el perfil a la configuración global; false si no corresponde a esta máquina.
+// Si se aplica sólo en parte, why explica qué se dejó de lado.
+static bool apply_profile(const TuneProfile& p, string& why) {
+    MicroKernel mk;
+    if (p.signature != detect_machine().signature()) { why = "la firma de la máquina no coincide"; return false; }
+    if (!find_micro_kernel(p.kernel, mk)) { why = "micro-kernel " + p.kernel + " no disponible"; return false; }
+    if (p.bp.MC % mk.MR || p.bp.NC % mk.NR) { why = "bloques incompatibles con el micro-kernel"; return false; }
+    if (const char* env = getenv("MATMUL_KERNEL")) {  // la variable de entorno sigue mandando
+        g_blk = block_params_for_caches(g_kernel);
+        why = string("MATMUL_KERNEL=") + env + ": se ignoran el micro-kernel (" + p.kernel + ") y los bloques MC=" +
+              to_string(p.bp.MC) + " KC=" + to_string(p.bp.KC) + " NC=" + to_string(p.bp.NC) + " del perfil";
+    } else {
+        g_kernel = mk;
+        g_blk = p.bp;
+    }
+    g_tile_m = p.tile_m;
+    g_tile_n = p.tile_n;
+    return true;
+}
+
+// ----------------- SUMMA DISTRIBUIDO (procesos en una grilla 2D) -----------------
+// P procesos en una grilla pr x pc; el proceso (i, j) guarda el bloque (i, j) de
+// A (M x K), B (K x N) y C (M x N) y nada más. En cada paso k, el dueño de la
+// columna de A que contiene k difunde su panel por su fila de procesos y el dueño
+// de la fila de B lo difunde por su columna; cada proceso acumula
+// C_ij += A_panel * B_panel. La sumatoria se junta sumando parciales en el rango 0.
+//
+// Canales punto a punto intercambiables: TCP (sirve igual entre nodos, con
+// --hosts) o anillos en memoria compartida entre procesos de la misma máquina.
+
+struct Channel {
+    virtual ~Channel() = default;
+    virtual void send(const void* buf, size_t bytes) = 0;
+    virtual void recv(void* buf, size_t bytes) = 0;
+};
+
+class TcpChannel : public Channel {
+public:
+    explicit TcpChannel(int fd) : fd(fd) {}
+    ~TcpChannel() override { close(fd); }
+    void send(const void* buf, size_t bytes) override {
+        const char* p = (const char*)buf;
+        while (bytes > 0) {
+            const ssize_t r = ::send(fd, p, bytes, MSG_NOSIGNAL);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) throw runtime_error(string("send: ") + strerror(errno));
+            p += r; bytes -= r;
+        }
+    }
+    void recv(void* buf, size_t bytes) override {
+        char* p = (char*)buf;
+        while (bytes > 0) {
+            const ssize_t r = ::recv(fd, p, bytes, 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) throw runtime_error(r == 0 ? "recv: conexión cerrada" : string("recv: ") + strerror(errno));
+            p += r; bytes -= r;
+        }
+    }
+private:
+    int fd;
+};
+
+// Anillo productor único / consumidor único en memoria compartida (MAP_SHARED
+// creado antes del fork); head y tail son atómicos sin lock, válidos entre procesos.
+struct ShmRing {
+    static constexpr size_t CAP = 1 << 20;
+    alignas(64) atomic<uint64_t> head;  // bytes escritos
+    alignas(64) atomic<uint64_t> tail;  // bytes leídos
+    alignas(64) char data[CAP];
+};
+
+class ShmChannel : public Channel {
+public:
+    ShmChannel(ShmRing* out, ShmRing* in) : out(out), in(in) {}
+    void send(const void* buf, size_t bytes) override {
+        const char* p = (const char*)buf;
+        while (bytes > 0) {
+            const uint64_t h = out->head.load(memory_order_relaxed);
+            const size_t space = ShmRing::CAP - (size_t)(h - out->tail.load(memory_order_acquire));
+            if (space == 0) { sched_yield(); continue; }
+            const size_t pos = h % ShmRing::CAP;
+            const size_t n = min({bytes, space, ShmRing::CAP - pos});
+            memcpy(out->data + pos, p, n);
+            out->head.store(h + n, memory_order_release);
+            p += n; bytes -= n;
+        }
+    }
+    void recv(void* buf, size_t bytes) override {
+        char* p = (char*)buf;
+        while (bytes > 0) {
+            const uint64_t t = in->tail.load(memory_order_relaxed);
+            const size_t avail = (size_t)(in->head.load(memory_order_acquire) - t);
+            if (avail == 0) { sched_yield(); continue; }
+            const size_t pos = t % ShmRing::CAP;
+            const size_t n = min({bytes, avail, ShmRing::CAP - pos});
+            memcpy(p, in->data + pos, n);
+            in->tail.store(t + n, memory_order_release);
+            p += n; bytes -= n;
+        }
+    }
+private:
+    ShmRing* out;
+    ShmRing* in;
+};
+
+// "host:puerto" -> sockaddr (IPv4 o nombre resoluble)
+static bool resolve_endpoint(const string& ep, sockaddr_storage& addr, socklen_t& len) {
+    const size_t colon = ep.rfind(':');
+    if (colon == string::npos) return false;
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(ep.substr(0, colon).c_str(), ep.substr(colon + 1).c_str(), &hints, &res) != 0) return false;
+    memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return true;
+}
+
+// Malla completa TCP: el rango r escucha en hosts[r], se conecta a los rangos
+// menores (con reintentos mientras arrancan) y acepta a los mayores.
+static vector<unique_ptr<Channel>> tcp_mesh(int rank, const vector<string>& hosts) {
+    const int P = (int)hosts.size();
+    vector<unique_ptr<Channel>> ch(P);
+    sockaddr_storage addr;
+    socklen_t len;
+    if (!resolve_endpoint(hosts[rank], addr, len)) throw runtime_error("dirección inválida: " + hosts[rank]);
+    const int ls = socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    ((sockaddr_in&)addr).sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(ls, (sockaddr*)&addr, len) != 0 || listen(ls, P) != 0)
+        throw runtime_error("no se pudo escuchar en " + hosts[rank] + ": " + strerror(errno));
+
+    for (int peer = 0; peer < rank; ++peer) {
+        if (!resolve_endpoint(hosts[peer], addr, len)) throw runtime_error("dirección inválida: " + hosts[peer]);
+        int fd = -1;
+        for (int attempt = 0; attempt < 1000; ++attempt) {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(fd, (sockaddr*)&addr, len) == 0) break;
+            close(fd);
+            fd = -1;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        if (fd < 0) throw runtime_error("no se pudo conectar con " + hosts[peer]);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ch[peer] = make_unique<TcpChannel>(fd);
+        ch[peer]->send(&rank, sizeof(rank));
+    }
+    for (int n = rank + 1; n < P; ++n) {
+        const int fd = accept(ls, nullptr, nullptr);
+        if (fd < 0) throw runtime_error(string("accept: ") + strerror(errno));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        auto c = make_unique<TcpChannel>(fd);
+        int peer = -1;
+        c->recv(&peer, sizeof(peer));
+        if (peer <= rank || peer >= P) throw runtime_error("rango inesperado en la conexión");
+        ch[peer] = move(c);
+    }
+    close(ls);
+    return ch;
+}
+
+struct SummaConfig {
+    int M, K, N, pr, pc, panel, threads;
+    bool random, verify;
+    float a_val, b_val;
+};
+
+static inline float summa_a(const SummaConfig& c, int i, int k) {
+    return c.random ? hashed_value(1, (uint64_t)i * c.K + k) : c.a_val;
+}
+static inline float summa_b(const SummaConfig& c, int k, int j) {
+    return c.random ? hashed_value(2, (uint64_t)k * c.N + j) : c.b_val;
+}
+
+// Primer índice de la parte que contiene x al partir n en p partes (owned_rows)
+static inline int part_of(int n, int p, int x) {
+    int t = (int)((long long)x * p / n);
+    while (owned_rows(n, p, t).second <= x) ++t;
+    while (owned_rows(n, p, t).first > x) --t;
+    return t;
+}
+
+// Un proceso SUMMA; en el rango 0 imprime el resumen. Devuelve 0 si todo salió bien.
+static int summa_worker(int rank, const SummaConfig& cfg, vector<unique_ptr<Channel>>& ch) {
+    const int P = cfg.pr * cfg.pc, my_i = rank / cfg.pc, my_j = rank % cfg.pc;
+    auto [r0, r1] = owned_rows(cfg.M, cfg.pr, my_i);   // filas de A y C
+    auto [c0, c1] = owned_rows(cfg.N, cfg.pc, my_j);   // columnas de B y C
+    auto [ak0, ak1] = owned_rows(cfg.K, cfg.pc, my_j); // columnas de A que guardo
+    auto [bk0, bk1] = owned_rows(cfg.K, cfg.pr, my_i); // filas de B que guardo
+    const int mloc = r1 - r0, nloc = c1 - c0;
+
+    // Bloques locales (cada proceso genera sólo lo suyo)
+    avec<float> A((size_t)mloc * (ak1 - ak0)), B((size_t)(bk1 - bk0) * nloc), C((size_t)mloc * nloc, 0.0f);
+    for (int i = 0; i < mloc; ++i)
+        for (int k = ak0; k < ak1; ++k) A[(size_t)i * (ak1 - ak0) + (k - ak0)] = summa_a(cfg, r0 + i, k);
+    for (int k = bk0; k < bk1; ++k)
+        for (int j = 0; j < nloc; ++j) B[(size_t)(k - bk0) * nloc + j] = summa_b(cfg, k, c0 + j);
+    avec<float> Ap((size_t)mloc * cfg.panel), Bp((size_t)cfg.panel * nloc);
+
+    // Barrera simple en el rango 0 para medir desde el mismo instante
+    auto barrier = [&] {
+        char tok = 0;
+        if (rank == 0) {
+            for (int p = 1; p < P; ++p) ch[p]->recv(&tok, 1);
+            for (int p = 1; p < P; ++p) ch[p]->send(&tok, 1);
+        } else {
+            ch[0]->send(&tok, 1);
+            ch[0]->recv(&tok, 1);
+        }
+    };
+    barrier();
+    const auto t_start = Clock::now();
+    double comm_ms = 0.0, comp_ms = 0.0;
+
+    bool first = true;
+    for (int k = 0; k < cfg.K;) {
+        const int ja = part_of(cfg.K, cfg.pc, k), ib = part_of(cfg.K, cfg.pr, k);
+        const int kend = min({owned_rows(cfg.K, cfg.pc, ja).second, owned_rows(cfg.K, cfg.pr, ib).second, k + cfg.panel});
+        const int w = kend - k;
+
+        auto tc = Clock::now();
+        // Panel de A (mloc x w) a lo largo de la fila de procesos
+        if (my_j == ja) {
+            const int lda = ak1 - ak0;
+            for (int i = 0; i < mloc; ++i)
+                memcpy(Ap.data() + (size_t)i * w, A.data() + (size_t)i * lda + (k - ak0), w * sizeof(float));
+            for (int j = 0; j < cfg.pc; ++j)
+                if (j != my_j) ch[my_i * cfg.pc + j]->send(Ap.data(), (size_t)mloc * w * sizeof(float));
+        } else {
+            ch[my_i * cfg.pc + ja]->recv(Ap.data(), (size_t)mloc * w * sizeof(float));
+        }
+        // Panel de B (w x nloc) a lo largo de la columna de procesos
+        if (my_i == ib) {
+            memcpy(Bp.data(), B.data() + (size_t)(k - bk0) * nloc, (size_t)w * nloc * sizeof(float));
+            for (int i = 0; i < cfg.pr; ++i)
+                if (i != my_i) ch[i * cfg.pc + my_j]->send(Bp.data(), (size_t)w * nloc * sizeof(float));
+        } else {
+            ch[ib * cfg.pc + my_j]->recv(Bp.data(), (size_t)w * nloc * sizeof(float));
+        }
+        auto tm = Clock::now();
+        comm_ms += chrono::duration_cast<ms>(tm - tc).count();
+
+        if (mloc > 0 && nloc > 0)
+            sgemm(SgemmRowMajor, SgemmNoTrans, SgemmNoTrans, mloc, nloc, w, 1.0f, Ap.data(), w,
+                  Bp.data(), nloc, first ? 0.0f : 1.0f, C.data(), max(1, nloc), cfg.threads);
+        first = false;
+        comp_ms += chrono::duration_cast<ms>(Clock::now() - tm).count();
+        k = kend;
+    }
+    double local_sum = 0.0;
+    for (float v : C) local_sum += v;
+    const double wall_ms = chrono::duration_cast<ms>(Clock::now() - t_start).count();
+
+    // Reducción de la sumatoria y de los tiempos en el rango 0
+    const double mine[4] = {local_sum, comp_ms, comm_ms, wall_ms};
+    if (rank != 0) {
+        ch[0]->send(mine, sizeof(mine));
+        if (cfg.verify) ch[0]->send(C.data(), C.size() * sizeof(float));
+        return 0;
+    }
+    vector<array<double, 4>> all(P);
+    copy(begin(mine), end(mine), all[0].begin());
+    for (int p = 1; p < P; ++p) ch[p]->recv(all[p].data(), sizeof(double) * 4);
+
+    double total = 0.0, max_wall = 0.0;
+    cout << fixed << setprecision(3);
+    for (int p = 0; p < P; ++p) {
+        total += all[p][0];
+        max_wall = max(max_wall, all[p][3]);
+        cout << "  rango " << p << " (" << p / cfg.pc << "," << p % cfg.pc << "): cálculo " << all[p][1]
+             << " ms  comunicación " << all[p][2] << " ms  sumatoria parcial " << all[p][0] << "\n";
+    }
+    cout << "Sumatoria (SUMMA) = " << total << "\n";
+    cout << "Tiempo: " << max_wall << " ms  " << gflops(cfg.M, cfg.K, cfg.N, max_wall) << " GFLOP/s\n";
+
+    if (cfg.verify) {
+        // Junta C y la compara con el camino secuencial por bloques
+        Matrix Cd((size_t)cfg.M * cfg.N), Af((size_t)cfg.M * cfg.K), Bf((size_t)cfg.K * cfg.N), Cs((size_t)cfg.M * cfg.N);
+        for (int p = 0; p < P; ++p) {
+            auto [pr0, pr1] = owned_rows(cfg.M, cfg.pr, p / cfg.pc);
+            auto [pc0, pc1] = owned_rows(cfg.N, cfg.pc, p % cfg.pc);
+            vector<float> blk((size_t)(pr1 - pr0) * (pc1 - pc0));
+            if (p == 0) copy(C.begin(), C.end(), blk.begin());
+            else ch[p]->recv(blk.data(), blk.size() * sizeof(float));
+            for (int i = pr0; i < pr1; ++i)
+                copy(blk.begin() + (size_t)(i - pr0) * (pc1 - pc0), blk.begin() + (size_t)(i - pr0 + 1) * (pc1 - pc0),
+                     Cd.begin() + (size_t)i * cfg.N + pc0);
+        }
+        for (int i = 0; i < cfg.M; ++i)
+            for (int k = 0; k < cfg.K; ++k) Af[(size_t)i * cfg.K + k] = summa_a(cfg, i, k);
+        for (int k = 0; k < cfg.K; ++k)
+            for (int j = 0; j < cfg.N; ++j) Bf[(size_t)k * cfg.N + j] = summa_b(cfg, k, j);
+        const double sum_seq = matmul_blocked_sum(Cs, Af, Bf, cfg.M, cfg.K, cfg.N);
+        double max_abs = 0.0, max_ref = 0.0;
+        for (size_t i = 0; i < Cs.size(); ++i) {
+            max_abs = max(max_abs, (double)fabs(Cs[i] - Cd[i]));
+            max_ref = max(max_ref, (double)fabs(Cs[i]));
+        }
+        const double rel = fabs(sum_seq - total) / max(1.0, fabs(sum_seq));
+        cout << "Sumatoria (secuencial) = " << sum_seq << "\n";
+        cout << scientific << setprecision(3) << "rel_diff sumatorias=" << rel << "  error máx. por elemento="
+             << max_abs << " (relativo " << max_abs / max(1e-30, max_ref) << ")\n";
+        if (max_abs > 1e-4 * max(1.0, max_ref)) {
+            cout << "ERROR: SUMMA no coincide con la versión secuencial\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Grilla lo más cuadrada posible: pr <= pc, pr * pc = P
+static pair<int, int> process_grid(int P) {
+    int pr = (int)sqrt((double)P);
+    while (P % pr) --pr;
+    return {pr, P / pr};
+}
+
+// Opciones "--clave=valor" (o "--clave") mezcladas con los argumentos posicionales.
+struct Options {
+    vector<string> positional;
+    map<string, string> named;
+
+    bool has(const string& k) const { return named.count(k) > 0; }
+    string get(const string& k, const string& def = "") const {
+        auto it = named.find(k);
+        return it == named.end() ? def : it->second;
+    }
+    long long get_int(const string& k, long long def) const {
+        auto it = named.find(k);
+        return (it == named.end() || it->second.empty()) ? def : stoll(it->second);
+    }
+};
+
+static Options parse_options(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        string s = argv[i];
+        if (s.rfind("--", 0) == 0) {
+            size_t eq = s.find('=');
+            if (eq == string::npos) o.named[s.substr(2)] = "";
+            else o.named[s.substr(2, eq - 2)] = s.substr(eq + 1);
+        } else {
+            o.positional.push_back(s);
+        }
+    }
+    return o;
+}
+
+// --modo=strassen: clásico (tiles paralelos) vs Strassen-Winograd, sin pausas.
+static int run_strassen_mode(int N, int num_threads, const Options& opt, float a_val, float b_val) {
+    StrassenPlan sp = strassen_plan(N, (int)opt.get_int("cutoff", 1024));
+    const bool random = opt.has("aleatorio");
+    cout << "Modo Strassen-Winograd: cutoff=" << sp.cutoff << "  niveles=" << sp.levels
+         << "  N rellenado=" << sp.padded
+         << "  datos=" << (random ? "aleatorios" : "constantes") << "\n";
+
+    Matrix A((size_t)N * N), B((size_t)N * N), C((size_t)N * N), C2((size_t)N * N);
+    if (random) {
+        first_touch_fill_random(A, N, N, 1, num_threads);
+        first_touch_fill_random(B, N, N, 2, num_threads);
+    } else {
+        first_touch_fill(A, N, N, a_val, num_threads);
+        first_touch_fill(B, N, N, b_val, num_threads);
+    }
+    first_touch_fill(C, N, N, 0.0f, num_threads);
+    first_touch_fill(C2, N, N, 0.0f, num_threads);
+
+    auto t0 = Clock::now();
+    double sum_cls = matmul_parallel_sum(C, A, B, N, num_threads);
+    double ms_cls = chrono::duration_cast<ms>(Clock::now() - t0).count();
+
+    auto t1 = Clock::now();
+    double sum_str = matmul_strassen_sum(C2, A, B, N, num_threads, sp);
+    double ms_str = chrono::duration_cast<ms>(Clock::now() - t1).count();
+
+    double max_abs = 0.0, max_ref = 0.0;
+    for (size_t i = 0; i < (size_t)N * N; ++i) {
+        max_abs = max(max_abs, (double)fabs(C[i] - C2[i]));
+        max_ref = max(max_ref, (double)fabs(C[i]));
+    }
+
+    cout << fixed << setprecision(6);
+    print_corners("C (clásico)", corners_of(C, N));
+    print_corners("C (Strassen)", corners_of(C2, N));
+    cout << "Sumatoria (clásico)  = " << sum_cls << "\n";
+    cout << "Sumatoria (Strassen) = " << sum_str << "\n";
+    cout << "Tiempo clásico:  " << ms_cls / 1000.0 << " s  (" << gflops(N, ms_cls) << " GFLOP/s)\n";
+    cout << "Tiempo Strassen: " << ms_str / 1000.0 << " s  (" << gflops(N, ms_str)
+         << " GFLOP/s equivalentes)\n";
+    if (ms_str > 0.0) cout << "Speedup Strassen vs clásico = " << ms_cls / ms_str << "x\n";
+
+    double rel_diff = fabs(sum_cls - sum_str) / max(1.0, fabs(sum_cls));
+    cout << scientific << setprecision(3);
+    cout << "rel_diff (sumatorias) = " << rel_diff
+         << "   error máx. por elemento = " << max_abs
+         << " (relativo " << max_abs / max(1e-30, max_ref) << ")\n";
+    return 0;
+}
+
+// --modo=precision: fp32 de referencia vs bf16, fp16 e int8 (tiempo, memoria y error).
+static int run_precision_mode(int N, int num_threads, const Options& opt, float a_val, float b_val) {
+    const bool random = opt.has("aleatorio");
+    Matrix A((size_t)N * N), B((size_t)N * N), C((size_t)N * N), Cq((size_t)N * N);
+    if (random) {
+        first_touch_fill_random(A, N, N, 1, num_threads);
+        first_touch_fill_random(B, N, N, 2, num_threads);
+    } else {
+        first_touch_fill(A, N, N, a_val, num_threads);
+        first_touch_fill(B, N, N, b_val, num_threads);
+    }
+    first_touch_fill(C, N, N, 0.0f, num_threads);
+    first_touch_fill(Cq, N, N, 0.0f, num_threads);
+
+    auto t0 = Clock::now();
+    double sum_ref = matmul_parallel_sum(C, A, B, N, num_threads);
+    double ms_ref = chrono::duration_cast<ms>(Clock::now() - t0).count();
+    double ref_norm = 0.0;
+    for (size_t i = 0; i < (size_t)N * N; ++i) ref_norm += (double)C[i] * C[i];
+    ref_norm = sqrt(ref_norm);
+
+    cout << fixed << setprecision(3);
+    cout << "Modo precisión mixta  datos=" << (random ? "aleatorios" : "constantes") << "\n";
+    cout << "fp32: " << ms_ref << " ms  " << gflops(N, ms_ref) << " GFLOP/s  A+B="
+         << (2.0 * N * N * sizeof(float)) / (1 << 20) << " MiB\n";
+
+    for (LowPrec prec : {LowPrec::BF16, LowPrec::FP16, LowPrec::INT8}) {
+        LowPrecMatrix Aq = quantize(A, N, N, prec, true);
+        LowPrecMatrix Bq = quantize(B, N, N, prec, false);
+
+        auto t1 = Clock::now();
+        double sum_q = matmul_lowprec_sum(Cq, Aq, Bq, num_threads);
+        double ms_q = chrono::duration_cast<ms>(Clock::now() - t1).count();
+
+        double max_abs = 0.0, err_norm = 0.0;
+        for (size_t i = 0; i < (size_t)N * N; ++i) {
+            const double d = (double)Cq[i] - C[i];
+            max_abs = max(max_abs, fabs(d));
+            err_norm += d * d;
+        }
+        const double rel_diff = fabs(sum_ref - sum_q) / max(1.0, fabs(sum_ref));
+        cout << fixed << setprecision(3);
+        cout << lowprec_name(prec) << ": " << ms_q << " ms  " << gflops(N, ms_q) << " GFLOP/s  A+B="
+             << (Aq.bytes() + Bq.bytes()) / double(1 << 20) << " MiB  (x"
+             << (ms_q > 0.0 ? ms_ref / ms_q : 0.0) << " vs fp32)\n";
+        cout << scientific << setprecision(3)
+             << "      error máx.=" << max_abs << "  error rel. (Frobenius)=" << sqrt(err_norm) / max(1e-30, ref_norm)
+             << "  rel_diff sumatorias=" << rel_diff << "\n";
+    }
+    return 0;
+}
+
+// Formas "MxKxN" o "N" (cuadrada)
+static bool parse_shape(const string& s, int& M, int& K, int& N) {
+    if (sscanf(s.c_str(), "%dx%dx%d", &M, &K, &N) == 3) return M > 0 && K > 0 && N > 0;
+    if (sscanf(s.c_str(), "%d", &N) == 1 && s.find('x') == string::npos) { M = K = N; return N > 0; }
+    return false;
+}
+
+// --modo=lote: lote de matrices chicas con gemm_batch vs una llamada paralela
+// por matriz (hilos lanzados en cada una, como el matmul_parallel_sum original).
+static int run_batch_mode(int num_threads, const Options& opt) {
+    const int count = (int)opt.get_int("cantidad", 10000);
+    const string shape = opt.get("forma", "32x32x32");
+    int fM = 0, fK = 0, fN = 0;
+    const bool varied = shape == "variada";
+    if (!varied && !parse_shape(shape, fM, fK, fN)) {
+        cerr << "Forma inválida: " << shape << " (use MxKxN, N o 'variada')\n";
+        return 1;
+    }
+
+    mt19937 rng(12345);
+    uniform_int_distribution<int> dim(4, 96);
+    vector<int> Ms(count), Ks(count), Ns(count);
+    size_t total_a = 0, total_b = 0, total_c = 0;
+    double flops = 0.0;
+    for (int b = 0; b < count; ++b) {
+        Ms[b] = varied ? dim(rng) : fM;
+        Ks[b] = varied ? dim(rng) : fK;
+        Ns[b] = varied ? dim(rng) : fN;
+        total_a += (size_t)Ms[b] * Ks[b];
+        total_b += (size_t)Ks[b] * Ns[b];
+        total_c += (size_t)Ms[b] * Ns[b];
+        flops += 2.0 * Ms[b] * Ns[b] * Ks[b];
+    }
+    Matrix A(total_a), B(total_b), C1(total_c), C2(total_c);
+    for (size_t i = 0; i < total_a; ++i) A[i] = hashed_value(1, i);
+    for (size_t i = 0; i < total_b; ++i) B[i] = hashed_value(2, i);
+
+    vector<GemmBatchItem> batch(count), batch_ref(count);
+    for (size_t b = 0, oa = 0, ob = 0, oc = 0; b < (size_t)count; ++b) {
+        batch[b] = {Ms[b], Ns[b], Ks[b], A.data() + oa, B.data() + ob, C1.data() + oc};
+        batch_ref[b] = batch[b];
+        batch_ref[b].C = C2.data() + oc;
+        oa += (size_t)Ms[b] * Ks[b];
+        ob += (size_t)Ks[b] * Ns[b];
+        oc += (size_t)Ms[b] * Ns[b];
+    }
+
+    cout << "Modo lote: " << count << " matrices  forma=" << shape << "  hilos=" << num_threads << "\n";
+
+    // Referencia: una multiplicación paralela por matriz, lanzando hilos cada vez
+    auto t0 = Clock::now();
+    for (const auto& it : batch_ref) {
+        vector<thread> ths;
+        const int T = max(1, min(num_threads, it.M));
+        for (int t = 0; t < T; ++t) {
+            ths.emplace_back([&, t]() {
+                auto [r0, r1] = owned_rows(it.M, T, t);
+                gemm_blocked(r1 - r0, it.N, it.K, it.A + (size_t)r0 * it.K, it.K, 1, it.B, it.N, 1,
+                             it.C + (size_t)r0 * it.N, it.N);
+            });
+        }
+        for (auto& th : ths) th.join();
+    }
+    double ms_ref = chrono::duration_cast<ms>(Clock::now() - t0).count();
+
+    vector<double> sums;
+    gemm_batch(batch, num_threads, &sums);  // calentamiento: crea los trabajadores del pool
+    auto t1 = Clock::now();
+    gemm_batch(batch, num_threads, &sums);
+    double ms_batch = chrono::duration_cast<ms>(Clock::now() - t1).count();
+
+    double max_abs = 0.0;
+    for (size_t i = 0; i < total_c; ++i) max_abs = max(max_abs, (double)fabs(C1[i] - C2[i]));
+
+    cout << fixed << setprecision(3);
+    cout << "Hilos por multiplicación: " << ms_ref << " ms  ("
+         << flops / (ms_ref * 1e6) << " GFLOP/s)\n";
+    cout << "gemm_batch:               " << ms_batch << " ms  ("
+         << flops / (ms_batch * 1e6) << " GFLOP/s)\n";
+    if (ms_batch > 0.0) cout << "Speedup lote = " << ms_ref / ms_batch << "x\n";
+    cout << scientific << setprecision(3) << "Diferencia máx. entre ambos = " << max_abs << "\n";
+    return 0;
+}
+
+// --modo=disperso: A dispersa generada directamente en CSR (memoria ~ nnz),
+// SpMV, SpMM CSR y BSR; si A entra en memoria como densa, compara con la GEMM
+// densa y con la elección automática por densidad.
+static int run_sparse_mode(int M, int K, int N, int num_threads, const Options& opt) {
+    const double density = stod(opt.get("densidad", "0.01"));
+    const int bs = max(1, (int)opt.get_int("bs", 4));
+    const int gen_bs = max(1, (int)opt.get_int("bloque", 1));
+    const bool skewed = opt.has("sesgado");
+    const double threshold = stod(opt.get("umbral", to_string(kSparseDensityThreshold)));
+
+    auto tg = Clock::now();
+    const CsrMatrix A = random_sparse_csr(M, K, density, gen_bs, skewed, 1);
+    const double ms_gen = chrono::duration_cast<ms>(Clock::now() - tg).count();
+    const double nnz = (double)A.nnz();
+    const vector<int> by_rows = [&] {
+        vector<int> b(num_threads + 1);
+        for (int t = 0; t <= num_threads; ++t) b[t] = (int)((long long)M * t / num_threads);
+        return b;
+    }();
+
+    cout << fixed << setprecision(3);
+    cout << "Modo disperso: densidad pedida=" << density << "  real=" << nnz / ((double)M * K)
+         << "  nnz=" << (long long)nnz << "  bloque generador=" << gen_bs
+         << (skewed ? "  (filas sesgadas)" : "") << "\n";
+    cout << "CSR: " << A.bytes() / double(1 << 20) << " MiB  vs densa "
+         << (double)M * K * sizeof(float) / (1 << 20) << " MiB  (generada en " << ms_gen << " ms)\n";
+    cout << "Desbalance de nnz por hilo: por filas=" << partition_imbalance(A.row_ptr, by_rows)
+         << "  por nnz=" << partition_imbalance(A.row_ptr, nnz_partition(A.row_ptr, num_threads)) << "\n";
+
+    // SpMV
+    avec<float> x(K), y(M);
+    for (int j = 0; j < K; ++j) x[j] = hashed_value(3, j);
+    spmv_csr_sum(A, x.data(), y.data(), num_threads);
+    auto tv = Clock::now();
+    const double sum_v = spmv_csr_sum(A, x.data(), y.data(), num_threads);
+    const double ms_v = chrono::duration_cast<ms>(Clock::now() - tv).count();
+    cout << "SpMV:      " << ms_v << " ms  " << (ms_v > 0.0 ? 2.0 * nnz / (ms_v * 1e6) : 0.0)
+         << " GFLOP/s  sumatoria=" << sum_v << "\n";
+
+    // SpMM con B densa
+    Matrix B((size_t)K * N), C((size_t)M * N);
+    first_touch_fill_random(B, K, N, 2, num_threads);
+    first_touch_fill(C, M, N, 0.0f, num_threads);
+    auto t0 = Clock::now();
+    const double sum_csr = spmm_csr_sum(A, B.data(), N, C.data(), num_threads);
+    const double ms_csr = chrono::duration_cast<ms>(Clock::now() - t0).count();
+    cout << "SpMM CSR:  " << ms_csr << " ms  " << (ms_csr > 0.0 ? 2.0 * nnz * N / (ms_csr * 1e6) : 0.0)
+         << " GFLOP/s útiles  sumatoria=" << sum_csr << "\n";
+
+    const BsrMatrix Ab = bsr_from_csr(A, bs);
+    auto t1 = Clock::now();
+    const double sum_bsr = spmm_bsr_sum(Ab, B.data(), N, C.data(), num_threads);
+    const double ms_bsr = chrono::duration_cast<ms>(Clock::now() - t1).count();
+    cout << "SpMM BSR" << bs << ": " << ms_bsr << " ms  relleno=" << (double)Ab.val.size() / max(1.0, nnz)
+         << "x  " << Ab.bytes() / double(1 << 20) << " MiB  sumatoria=" << sum_bsr << "\n";
+    const double rel_bsr = fabs(sum_bsr - sum_csr) / max(1.0, fabs(sum_csr));
+    if (rel_bsr > 1e-5) cout << "ADVERTENCIA: diferencia relativa BSR vs CSR = " << rel_bsr << "\n";
+
+    // Comparación con la densa (sólo si entra cómodamente en memoria)
+    if ((double)M * K > (double)opt.get_int("max-densa", 1LL << 26)) {
+        cout << "A densa no se materializa (M*K > --max-densa)\n";
+        return 0;
+    }
+    const Matrix Ad = dense_from_csr(A);
+    auto t2 = Clock::now();
+    const double sum_dense = matmul_parallel_sum(C, Ad, B, M, K, N, num_threads);
+    const double ms_dense = chrono::duration_cast<ms>(Clock::now() - t2).count();
+    cout << "GEMM densa: " << ms_dense << " ms  " << gflops(M, K, N, ms_dense) << " GFLOP/s"
+         << "  (CSR x" << (ms_csr > 0.0 ? ms_dense / ms_csr : 0.0) << ")\n";
+    const double rel = fabs(sum_dense - sum_csr) / max(1.0, fabs(sum_dense));
+    if (rel > 1e-5) cout << "ADVERTENCIA: diferencia relativa CSR vs densa = " << rel << "\n";
+
+    bool used_sparse = false;
+    auto t3 = Clock::now();
+    matmul_auto_sum(C, Ad, B, M, K, N, num_threads, &used_sparse, threshold);
+    const double ms_auto = chrono::duration_cast<ms>(Clock::now() - t3).count();
+    cout << "Automático (umbral " << threshold << "): " << (used_sparse ? "CSR" : "densa")
+         << "  " << ms_auto << " ms (incluye conteo y conversión)\n";
+    return 0;
+}
+
+// --modo=disco: A y B se generan en archivos y C se escribe a disco tile por tile
+static int run_ooc_mode(int M, int K, int N, int num_threads, const Options& opt, float a_val, float b_val) {
+    const string dir = opt.get("dir", "/tmp/matmul_disco");
+    const size_t budget = (size_t)opt.get_int("memoria", 256) << 20;
+    const bool random = opt.has("aleatorio");
+    mkdir(dir.c_str(), 0755);
+    cout << fixed << setprecision(3);
+    const string pa = dir + "/A.f32", pb = dir + "/B.f32", pc = dir + "/C.f32";
+
+    if (!opt.has("reusar")) {
+        auto tg = Clock::now();
+        if (random) {
+            write_matrix_file(pa, M, K, [&](int i, int j) { return hashed_value(1, (uint64_t)i * K + j); });
+            write_matrix_file(pb, K, N, [&](int i, int j) { return hashed_value(2, (uint64_t)i * N + j); });
+        } else {
+            write_matrix_file(pa, M, K, [&](int, int) { return a_val; });
+            write_matrix_file(pb, K, N, [&](int, int) { return b_val; });
+        }
+        cout << "Archivos generados en " << dir << " ("
+             << chrono::duration_cast<ms>(Clock::now() - tg).count() / 1000.0 << " s)\n";
+    }
+
+    OocPlan p;
+    try {
+        p = ooc_plan(M, K, N, budget, num_threads);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    const double mib = 1 << 20;
+    cout << "Modo disco: memoria=" << budget / mib << " MiB  tiles C " << p.tm << "x" << p.tn
+         << "  k=" << p.tk << "  buffers="
+         << 2.0 * ((double)p.tm * p.tn + (double)p.tm * p.tk + (double)p.tk * p.tn) * sizeof(float) / mib
+         << " MiB + empaquetado " << ooc_pack_bytes(num_threads) / mib << " MiB  (A+B+C en disco = "
+         << ((double)M * K + (double)K * N + (double)M * N) * sizeof(float) / mib << " MiB)\n";
+
+    OocStats st;
+    double sum;
+    try {
+        sum = gemm_out_of_core(pa, pb, pc, M, K, N, budget, num_threads, st);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    const double min_read = ((double)M * K + (double)K * N) * sizeof(float);
+    cout << "Sumatoria (disco) = " << sum << "\n";
+    cout << "Tiempo total: " << st.total_ms << " ms  " << gflops(M, K, N, st.total_ms) << " GFLOP/s"
+         << "  (cálculo " << st.compute_ms << " ms)\n";
+    cout << "Leído " << st.read_bytes / mib << " MiB (x" << st.read_bytes / min_read
+         << " de A+B)  escrito " << st.write_bytes / mib << " MiB  tiles leídos=" << st.tiles_read
+         << "  reusados=" << st.tiles_reused << "\n";
+    cout << "E/S " << st.io_ms << " ms  espera del cálculo por E/S " << st.wait_ms << " ms  (solapado "
+         << 100.0 * (st.io_ms > 0.0 ? max(0.0, 1.0 - st.wait_ms / st.io_ms) : 1.0) << "%)\n";
+
+    if (!random) {
+        const double esperado = (double)M * N * (double)(K * a_val * b_val);
+        cout << "(Referencia teórica) sumatoria≈" << esperado << "\n";
+    }
+    // Con tamaños que entran en memoria se puede comparar contra la versión en RAM
+    if (opt.has("verificar")) {
+        Matrix A((size_t)M * K), B((size_t)K * N), C((size_t)M * N), Cd((size_t)M * N);
+        const int fa = open(pa.c_str(), O_RDONLY), fb = open(pb.c_str(), O_RDONLY), fc = open(pc.c_str(), O_RDONLY);
+        if (fa < 0 || fb < 0 || fc < 0) {
+            cerr << "Error: no se pudieron abrir los archivos para verificar: " << strerror(errno) << "\n";
+            if (fa >= 0) close(fa);
+            if (fb >= 0) close(fb);
+            if (fc >= 0) close(fc);
+            return 1;
+        }
+        try {
+            read_tile(fa, K, 0, 0, M, K, A.data());
+            read_tile(fb, N, 0, 0, K, N, B.data());
+            read_tile(fc, N, 0, 0, M, N, Cd.data());
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            close(fa); close(fb); close(fc);
+            return 1;
+        }
+        close(fa); close(fb); close(fc);
+        const double sum_mem = matmul_parallel_sum(C, A, B, M, K, N, num_threads);
+        double max_abs = 0.0;
+        for (size_t i = 0; i < C.size(); ++i) max_abs = max(max_abs, (double)fabs(C[i] - Cd[i]));
+        cout << scientific << setprecision(3) << "Verificación en RAM: rel_diff sumatorias="
+             << fabs(sum_mem - sum) / max(1.0, fabs(sum_mem)) << "  error máx. en C=" << max_abs << "\n";
+    }
+    return 0;
+}
+
+// --modo=sgemm: las 8 combinaciones disposición x op(A) x op(B) con alpha, beta
+// y pasos con relleno, contra una referencia directa
+static int run_sgemm_mode(int M, int K, int N, int num_threads, const Options& opt) {
+    const float alpha = stof(opt.get("alpha", "1.5")), beta = stof(opt.get("beta", "-0.5"));
+    const int pad = (int)opt.get_int("relleno", 3);
+    cout << "Modo sgemm: alpha=" << alpha << "  beta=" << beta << "  relleno ld=" << pad << "\n";
+    bool ok = true;
+    for (SgemmLayout layout : {SgemmRowMajor, SgemmColMajor})
+        for (SgemmOp ta : {SgemmNoTrans, SgemmTrans})
+            for (SgemmOp tb : {SgemmNoTrans, SgemmTrans}) {
+                const bool row = layout == SgemmRowMajor;
+                const int a_rows = ta == SgemmTrans ? K : M, a_cols = ta == SgemmTrans ? M : K;
+                const int b_rows = tb == SgemmTrans ? N : K, b_cols = tb == SgemmTrans ? K : N;
+                const int lda = (row ? a_cols : a_rows) + pad, ldb = (row ? b_cols : b_rows) + pad;
+                const int ldc = (row ? N : M) + pad;
+                Matrix A((size_t)(row ? a_rows : a_cols) * lda), B((size_t)(row ? b_rows : b_cols) * ldb);
+                Matrix C((size_t)(row ? M : N) * ldc);
+                for (size_t i = 0; i < A.size(); ++i) A[i] = hashed_value(1, i);
+                for (size_t i = 0; i < B.size(); ++i) B[i] = hashed_value(2, i);
+                for (size_t i = 0; i < C.size(); ++i) C[i] = hashed_value(3, i);
+
+                // Referencia en double con la definición de BLAS
+                auto at = [&](const Matrix& X, int ld, int r, int c) {
+                    return (double)(row ? X[(size_t)r * ld + c] : X[(size_t)c * ld + r]);
+                };
+                vector<double> ref((size_t)M * N);
+                for (int i = 0; i < M; ++i)
+                    for (int j = 0; j < N; ++j) {
+                        double acc = 0.0;
+                        for (int k = 0; k < K; ++k)
+                            acc += (ta == SgemmTrans ? at(A, lda, k, i) : at(A, lda, i, k))
+                                 * (tb == SgemmTrans ? at(B, ldb, j, k) : at(B, ldb, k, j));
+                        ref[(size_t)i * N + j] = alpha * acc + beta * at(C, ldc, i, j);
+                    }
+
+                auto t0 = Clock::now();
+                sgemm(layout, ta, tb, M, N, K, alpha, A.data(), lda, B.data(), ldb, beta, C.data(), ldc, num_threads);
+                const double ms_s = chrono::duration_cast<ms>(Clock::now() - t0).count();
+
+                double max_rel = 0.0;
+                for (int i = 0; i < M; ++i)
+                    for (int j = 0; j < N; ++j) {
+                        const double r = ref[(size_t)i * N + j];
+                        max_rel = max(max_rel, fabs(at(C, ldc, i, j) - r) / max(1.0, fabs(r)));
+                    }
+                ok = ok && max_rel < 1e-4;
+                cout << (row ? "fila-mayor   " : "columna-mayor") << "  op(A)=" << (ta == SgemmTrans ? "T" : "N")
+                     << "  op(B)=" << (tb == SgemmTrans ? "T" : "N") << fixed << setprecision(3)
+                     << "  " << ms_s << " ms  " << gflops(M, K, N, ms_s) << " GFLOP/s"
+                     << scientific << setprecision(3) << "  error rel. máx.=" << max_rel
+                     << (max_rel < 1e-4 ? "" : "  <-- ERROR") << "\n";
+            }
+    return ok ? 0 : 1;
+}
+
+// --modo=epilogo: bias + activación + reducciones por fila/columna, en pasadas
+// separadas sobre C vs fusionadas en el micro-kernel (con y sin escribir C)
+static int run_epilogue_mode(int M, int K, int N, int num_threads, const Options& opt) {
+    const string act_name = opt.get("activacion", "relu");
+    Epilogue ep;
+    ep.scale = stof(opt.get("escala", "1"));
+    if (act_name == "relu") ep.act = Activation::ReLU;
+    else if (act_name == "gelu") ep.act = Activation::GELU;
+    else if (act_name != "ninguna") {
+        cerr << "Activación desconocida: " << act_name << " (relu, gelu o ninguna)\n";
+        return 1;
+    }
+
+    Matrix A((size_t)M * K), B((size_t)K * N), C((size_t)M * N), Cf((size_t)M * N);
+    avec<float> bias(N);
+    first_touch_fill_random(A, M, K, 1, num_threads);
+    first_touch_fill_random(B, K, N, 2, num_threads);
+    first_touch_fill(C, M, N, 0.0f, num_threads);
+    first_touch_fill(Cf, M, N, 0.0f, num_threads);
+    for (int j = 0; j < N; ++j) bias[j] = hashed_value(3, j);
+    ep.bias_col = bias.data();
+
+    // 1) GEMM y después una pasada por cada post-proceso
+    vector<double> rows_ref(M, 0.0), cols_ref(N, 0.0);
+    const int T = max(1, min(num_threads, M));
+    vector<vector<double>> cols_part(T, vector<double>(N, 0.0));
+    auto t0 = Clock::now();
+    matmul_parallel_sum(C, A, B, M, K, N, num_threads);
+    ThreadPool::instance().run(T, [&](int t) {  // bias + activación
+        auto [r0, r1] = owned_rows(M, T, t);
+        for (int i = r0; i < r1; ++i) {
+            float* c = C.data() + (size_t)i * N;
+            for (int j = 0; j < N; ++j) {
+                const float y = c[j] * ep.scale + bias[j];
+                c[j] = ep.act == Activation::ReLU ? max(y, 0.0f) : ep.act == Activation::GELU ? gelu(y) : y;
+            }
+        }
+    });
+    ThreadPool::instance().run(T, [&](int t) {  // sumatorias por fila
+        auto [r0, r1] = owned_rows(M, T, t);
+        for (int i = r0; i < r1; ++i) rows_ref[i] = tile_sum(C.data() + (size_t)i * N, 1, N, N);
+    });
+    ThreadPool::instance().run(T, [&](int t) {  // sumatorias por columna
+        auto [r0, r1] = owned_rows(M, T, t);
+        for (int i = r0; i < r1; ++i)
+            for (int j = 0; j < N; ++j) cols_part[t][j] += C[(size_t)i * N + j];
+    });
+    for (int t = 0; t < T; ++t)
+        for (int j = 0; j < N; ++j) cols_ref[j] += cols_part[t][j];
+    const double ms_sep = chrono::duration_cast<ms>(Clock::now() - t0).count();
+
+    auto check = [&](const vector<double>& rows, const vector<double>& cols) {
+        double err = 0.0;
+        for (int i = 0; i < M; ++i) err = max(err, fabs(rows[i] - rows_ref[i]) / max(1.0, fabs(rows_ref[i])));
+        for (int j = 0; j < N; ++j) err = max(err, fabs(cols[j] - cols_ref[j]) / max(1.0, fabs(cols_ref[j])));
+        return err;
+    };
+
+    // 2) Fusionado, escribiendo C
+    vector<double> rows(M, 0.0), cols(N, 0.0);
+    ep.row_sums = rows.data();
+    ep.col_sums = cols.data();
+    auto t1 = Clock::now();
+    gemm_fused(M, N, K, A.data(), B.data(), Cf.data(), ep, num_threads);
+    const double ms_fused = chrono::duration_cast<ms>(Clock::now() - t1).count();
+    double max_c = 0.0;
+    for (size_t i = 0; i < C.size(); ++i) max_c = max(max_c, (double)fabs(C[i] - Cf[i]));
+    const double err_fused = check(rows, cols);
+
+    // 3) Fusionado, sólo reducciones: C no se materializa
+    fill(rows.begin(), rows.end(), 0.0);
+    fill(cols.begin(), cols.end(), 0.0);
+    ep.store_c = false;
+    auto t2 = Clock::now();
+    gemm_fused(M, N, K, A.data(), B.data(), nullptr, ep, num_threads);
+    const double ms_red = chrono::duration_cast<ms>(Clock::now() - t2).count();
+    const double err_red = check(rows, cols);
+
+    cout << fixed << setprecision(3);
+    cout << "Modo epílogo: y = " << act_name << "(" << ep.scale << " * AB + bias)  + sumatorias por fila y columna\n";
+    cout << "Pasadas separadas:      " << ms_sep << " ms  " << gflops(M, K, N, ms_sep) << " GFLOP/s\n";
+    cout << "Fusionado (escribe C):  " << ms_fused << " ms  " << gflops(M, K, N, ms_fused) << " GFLOP/s  (x"
+         << (ms_fused > 0.0 ? ms_sep / ms_fused : 0.0) << ")\n";
+    cout << "Fusionado (sin C):      " << ms_red << " ms  " << gflops(M, K, N, ms_red) << " GFLOP/s  (x"
+         << (ms_red > 0.0 ? ms_sep / ms_red : 0.0) << ", " << (double)M * N * sizeof(float) / (1 << 20)
+         << " MiB de C no escritos)\n";
+    cout << scientific << setprecision(3) << "Diferencias: C máx.=" << max_c << "  reducciones (escribe C)="
+         << err_fused << "  reducciones (sin C)=" << err_red << "\n";
+    return 0;
+}
+
+// Mejor GFLOP/s de reps corridas de matmul_parallel_sum con la configuración global
+static double measure_gemm(const Matrix& A, const Matrix& B, Matrix& C, int N, int threads, int reps) {
+    double best = 0.0;
+    matmul_parallel_sum(C, A, B, N, threads);  // calentamiento (buffers de empaquetado, páginas)
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = Clock::now();
+        matmul_parallel_sum(C, A, B, N, threads);
+        best = max(best, gflops(N, chrono::duration_cast<ms>(Clock::now() - t0).count()));
+    }
+    return best;
+}
+
+static int run_tune_mode(const Options& opt) {
+    const MachineInfo mi = detect_machine();
+    cout << "CPU: " << mi.model << "\n"
+         << "CPUs lógicas=" << mi.logical << "  núcleos físicos=" << mi.physical << "  sockets=" << mi.sockets
+         << "  nodos NUMA=" << mi.numa_nodes << "\n";
+    for (const auto& c : mi.caches)
+        cout << "  L" << c.level << " " << c.type << ": " << c.bytes / 1024 << " KiB (compartida por "
+             << c.shared_cpus << " CPU)\n";
+
+    vector<int> sizes;
+    {
+        stringstream ss(opt.get("tamanos", "512,1024,2048"));
+        for (string t; getline(ss, t, ',');) if (!t.empty()) sizes.push_back(stoi(t));
+    }
+    const int reps = max(1, (int)opt.get_int("repeticiones", 2));
+    const double budget_ms = 1000.0 * opt.get_int("presupuesto-s", 120);
+    const auto t_start = Clock::now();
+    auto out_of_time = [&] { return chrono::duration_cast<ms>(Clock::now() - t_start).count() > budget_ms; };
+
+    struct Problem { int N; Matrix A, B, C; };
+    vector<Problem> probs;
+    for (int N : sizes) {
+        Problem p{N, Matrix((size_t)N * N), Matrix((size_t)N * N), Matrix((size_t)N * N)};
+        first_touch_fill_random(p.A, N, N, 1, mi.logical);
+        first_touch_fill_random(p.B, N, N, 2, mi.logical);
+        first_touch_fill(p.C, N, N, 0.0f, mi.logical);
+        probs.push_back(move(p));
+    }
+    // Media geométrica de GFLOP/s sobre los tamaños representativos
+    auto score = [&](int threads) {
+        double log_sum = 0.0;
+        for (auto& p : probs) log_sum += log(max(1e-9, measure_gemm(p.A, p.B, p.C, p.N, threads, reps)));
+        return exp(log_sum / probs.size());
+    };
+
+    // 1) micro-kernel y bloques, con un hilo (el bloqueo depende de las cachés de un núcleo)
+    const long L1 = cache_bytes(_SC_LEVEL1_DCACHE_SIZE, 32 << 10), L2 = cache_bytes(_SC_LEVEL2_CACHE_SIZE, 1 << 20);
+    TuneProfile best;
+    best.signature = mi.signature();
+    best.threads = mi.physical;  // si el presupuesto no alcanza para la etapa [2]
+    const MicroKernel default_kernel = g_kernel;
+    g_tile_m = g_tile_n = 0;
+    cout << fixed << setprecision(2) << "\n[1] micro-kernel y bloques (1 hilo)\n";
+    for (const MicroKernel& mk : available_micro_kernels()) {
+        const BlockParams base = block_params_for_caches(mk);
+        set<int> kcs;
+        for (double f : {0.25, 0.5, 0.75, 1.0})
+            kcs.insert(max(64, (int)(L1 * f / (mk.NR * sizeof(float))) / 8 * 8));
+        set<pair<int, int>> tried;
+        for (int kc : kcs) {
+            for (double f : {0.25, 0.5, 0.75}) {
+                if (out_of_time()) break;
+                BlockParams bp = base;
+                bp.KC = kc;
+                bp.MC = max(mk.MR, (int)(L2 * f / (kc * sizeof(float))) / mk.MR * mk.MR);
+                bp.MC = min(bp.MC, 2048 / mk.MR * mk.MR);
+                if (!tried.insert({bp.MC, bp.KC}).second) continue;
+                g_kernel = mk;
+                g_blk = bp;
+                const double s = score(1);
+                cout << "  " << mk.name << "  MC=" << bp.MC << " KC=" << bp.KC << " NC=" << bp.NC
+                     << "  -> " << s << " GFLOP/s\n";
+                if (s > best.gflops) { best.gflops = s; best.kernel = mk.name; best.bp = bp; }
+            }
+        }
+    }
+    if (best.kernel.empty()) {  // presupuesto agotado antes de medir algo
+        best.kernel = default_kernel.name;
+        best.bp = block_params_for_caches(default_kernel);
+        cout << "  (sin mediciones: se usa " << best.kernel << " con los bloques por defecto)\n";
+    }
+    if (!find_micro_kernel(best.kernel, g_kernel)) g_kernel = default_kernel;
+    g_blk = best.bp;
+
+    // 2) cantidad de hilos: 1, potencias de 2, núcleos físicos y CPUs lógicas
+    cout << "\n[2] hilos\n";
+    set<int> thread_opts = {1, mi.physical, mi.logical};
+    for (int t = 2; t < mi.logical; t *= 2) thread_opts.insert(t);
+    double best_t = 0.0;
+    for (int t : thread_opts) {
+        if (out_of_time()) break;
+        const double s = score(t);
+        cout << "  hilos=" << t << "  -> " << s << " GFLOP/s\n";
+        if (s > best_t * 1.03) { best_t = s; best.threads = t; }  // a igualdad, menos hilos
+    }
+    best.gflops = max(best.gflops, best_t);
+
+    // 3) forma de los tiles paralelos (0 = automática)
+    cout << "\n[3] tiles paralelos (hilos=" << best.threads << ")\n";
+    g_tile_m = g_tile_n = 0;
+    double best_tile = score(best.threads);
+    cout << "  automática  -> " << best_tile << " GFLOP/s\n";
+    for (int fm : {1, 2, 4})
+        for (int fn : {1, 2, 4}) {
+            if (out_of_time()) break;
+            const int tm = max(g_kernel.MR, g_blk.MC / fm / g_kernel.MR * g_kernel.MR);
+            const int tn = max(g_kernel.NR, g_blk.MC / fn / g_kernel.NR * g_kernel.NR);
+            g_tile_m = tm;
+            g_tile_n = tn;
+            const double s = score(best.threads);
+            cout << "  " << tm << "x" << tn << "  -> " << s << " GFLOP/s\n";
+            if (s > best_tile * 1.02) { best_tile = s; best.tile_m = tm; best.tile_n = tn; }
+        }
+    g_tile_m = best.tile_m;
+    g_tile_n = best.tile_n;
+    best.gflops = max(best.gflops, best_tile);
+    if (out_of_time()) cout << "(se agotó el presupuesto de tiempo; búsqueda parcial)\n";
+
+    const string path = opt.get("perfil", default_profile_path());
+    cout << "\nMejor: " << best.kernel << "  MC=" << best.bp.MC << " KC=" << best.bp.KC << " NC=" << best.bp.NC
+         << "  tiles=" << (best.tile_m ? to_string(best.tile_m) + "x" + to_string(best.tile_n) : string("auto"))
+         << "  hilos=" << best.threads << "  (" << best.gflops << " GFLOP/s)\n";
+    if (!save_profile(path, best)) {
+        cerr << "No se pudo escribir el perfil en " << path << "\n";
+        return 1;
+    }
+    cout << "Perfil guardado en " << path << "\n";
+    return 0;
+}
+
+// ----------------- SUITE DE BENCHMARKS (--modo=bench) -----------------
+// Barre tamaños e hilos sin pausas, repite cada corrida y compara todas las
+// variantes (i-k-j, bloques, cada micro-kernel en paralelo, Strassen, precisión
+// mixta y epílogo sin C) contra el techo de la máquina medido en el momento:
+// FLOP/s pico con el micro-kernel sobre paneles en L1 y ancho de banda con la
+// tríada de STREAM. Salida en CSV o JSON para detectar regresiones.
+
+// GFLOP/s pico: el micro-kernel repetido sobre paneles que viven en L1. Los
+// paneles se reservan, inicializan y calientan (una pasada) fuera del tiempo
+// medido, y se toma la mejor de varias repeticiones como en measure_stream_gbs.
+static double measure_peak_gflops(const MicroKernel& mk, int threads, int reps = 5) {
+    constexpr int kc = 128, iters = 20000;
+    struct Panels { avec<float> Ap, Bp, C; };
+    vector<Panels> panels(threads);
+    auto& pool = ThreadPool::instance();
+    pool.run(threads, [&](int t) {  // cada hilo toca sus paneles (first touch) y hace una pasada en frío
+        Panels& p = panels[t];
+        p.Ap.resize((size_t)kc * mk.MR);
+        p.Bp.resize((size_t)kc * mk.NR);
+        p.C.assign((size_t)mk.MR * mk.NR, 0.0f);
+        for (size_t i = 0; i < p.Ap.size(); ++i) p.Ap[i] = 1e-3f * (float)(i % 7);
+        for (size_t i = 0; i < p.Bp.size(); ++i) p.Bp[i] = 1e-3f * (float)(i % 5);
+        for (int it = 0; it < iters / 10; ++it)
+            mk.fn(kc, p.Ap.data(), p.Bp.data(), p.C.data(), mk.NR, mk.MR, mk.NR, true, nullptr, 0, 0);
+    });
+    double best = 0.0;
+    for (int r = 0; r < reps; ++r) {
+        const auto t0 = Clock::now();
+        pool.run(threads, [&](int t) {
+            Panels& p = panels[t];
+            for (int it = 0; it < iters; ++it)
+                mk.fn(kc, p.Ap.data(), p.Bp.data(), p.C.data(), mk.NR, mk.MR, mk.NR, true, nullptr, 0, 0);
+        });
+        // Tiempo de pared del conjunto: con más hilos que núcleos no se suma de más
+        const double s = chrono::duration<double>(Clock::now() - t0).count();
+        best = max(best, 2.0 * kc * mk.MR * mk.NR * iters * (double)threads / s / 1e9);
+    }
+    return best;
+}
+
+// GB/s de la tríada de STREAM a[i] = b[i] + s * c[i] (12 bytes por elemento)
+static double measure_stream_gbs(size_t elems, int threads, int reps) {
+    avec<float> a(elems), b(elems), c(elems);
+    ThreadPool::instance().run(threads, [&](int t) {  // first touch en el hilo que usará cada parte
+        const size_t i0 = elems * t / threads, i1 = elems * (t + 1) / threads;
+        for (size_t i = i0; i < i1; ++i) { a[i] = 0.0f; b[i] = 1.0f; c[i] = 2.0f; }
+    });
+    double best = 0.0;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = Clock::now();
+        ThreadPool::instance().run(threads, [&](int t) {
+            const size_t i0 = elems * t / threads, i1 = elems * (t + 1) / threads;
+            float* __restrict pa = a.data();
+            const float* __restrict pb = b.data();
+            const float* __restrict pc = c.data();
+            for (size_t i = i0; i < i1; ++i) pa[i] = pb[i] + 3.0f * pc[i];
+        });
+        const double s = chrono::duration<double>(Clock::now() - t0).count();
+        best = max(best, 12.0 * elems / s / 1e9);
+    }
+    return best;
+}
+
+struct BenchData { int N; Matrix A, B, C; };
+
+// make(data) prepara lo que la variante necesite (cuantizar, etc.) fuera del
+// tiempo medido y devuelve la corrida para una cantidad de hilos.
+struct BenchVariant {
+    string name;
+    bool parallel;
+    int max_n;  // 0 = sin límite
+    function<function<void(int)>(BenchData&)> make;
+};
+
+static vector<BenchVariant> bench_variants(const Options& opt) {
+    vector<BenchVariant> vs;
+    const int max_ikj = (int)opt.get_int("max-ikj", 1024);
+    vs.push_back({"ikj", false, max_ikj, [](BenchData& d) {
+        return function<void(int)>([&d](int) { matmul_serial_sum(d.C, d.A, d.B, d.N, d.N, d.N); });
+    }});
+    vs.push_back({"bloques", false, 0, [](BenchData& d) {
+        return function<void(int)>([&d](int) { matmul_blocked_sum(d.C, d.A, d.B, d.N, d.N, d.N); });
+    }});
+    for (const MicroKernel& mk : available_micro_kernels()) {
+        vs.push_back({string("paralelo-") + mk.name, true, 0, [mk](BenchData& d) {
+            return function<void(int)>([&d, mk](int T) {
+                const MicroKernel saved_k = g_kernel;
+                const BlockParams saved_b = g_blk;
+                g_kernel = mk;
+                if (saved_k.name != mk.name) g_blk = block_params_for_caches(mk);
+                matmul_parallel_sum(d.C, d.A, d.B, d.N, T);
+                g_kernel = saved_k;
+                g_blk = saved_b;
+            });
+        }});
+    }
+    const int cutoff = (int)opt.get_int("cutoff", 512);
+    vs.push_back({"strassen", true, 0, [cutoff](BenchData& d) {
+        const StrassenPlan sp = strassen_plan(d.N, cutoff);
+        return function<void(int)>([&d, sp](int T) { matmul_strassen_sum(d.C, d.A, d.B, d.N, T, sp); });
+    }});
+    for (LowPrec prec : {LowPrec::BF16, LowPrec::FP16, LowPrec::INT8}) {
+        vs.push_back({lowprec_name(prec), true, 0, [prec](BenchData& d) {
+            auto Aq = make_shared<LowPrecMatrix>(quantize(d.A, d.N, d.N, prec, true));
+            auto Bq = make_shared<LowPrecMatrix>(quantize(d.B, d.N, d.N, prec, false));
+            return function<void(int)>([&d, Aq, Bq](int T) { matmul_lowprec_sum(d.C, *Aq, *Bq, T); });
+        }});
+    }
+    vs.push_back({"epilogo-sin-C", true, 0, [](BenchData& d) {
+        return function<void(int)>([&d](int T) {
+            Epilogue ep;
+            ep.store_c = false;
+            gemm_fused(d.N, d.N, d.N, d.A.data(), d.B.data(), nullptr, ep, T);
+        });
+    }});
+
+    if (opt.has("variantes")) {  // filtro por prefijo: --variantes=ikj,paralelo,bf16
+        vector<string> keep;
+        stringstream ss(opt.get("variantes"));
+        for (string t; getline(ss, t, ',');) if (!t.empty()) keep.push_back(t);
+        vector<BenchVariant> sel;
+        for (auto& v : vs)
+            for (const auto& k : keep)
+                if (v.name.rfind(k, 0) == 0) { sel.push_back(v); break; }
+        vs = sel;
+    }
+    return vs;
+}
+
+struct BenchRow {
+    string variant;
+    int N, threads, reps;
+    double ms_min, ms_med, gflops, gbs, intensity, roof_gflops, roof_pct, efficiency;
+};
+
+static vector<int> parse_int_list(const string& s) {
+    vector<int> v;
+    stringstream ss(s);
+    for (string t; getline(ss, t, ',');) if (!t.empty()) v.push_back(stoi(t));
+    return v;
+}
+
+static int run_bench_mode(const Options& opt) {
+    const int hw = max(1, (int)allowed_cpus().size());
+    vector<int> sizes = parse_int_list(opt.get("tamanos", "256,512,1024,2048"));
+    vector<int> thread_list = parse_int_list(opt.get("hilos", ""));
+    if (thread_list.empty())
+        for (int t = 1; t <= hw; t = t < hw && 2 * t > hw ? hw : 2 * t) thread_list.push_back(t);
+    const int reps = max(1, (int)opt.get_int("repeticiones", 3));
+    const string format = opt.get("formato", "csv");
+    const string out_path = opt.get("salida", "");
+    const vector<BenchVariant> variants = bench_variants(opt);
+
+    // Techo de la máquina para cada cantidad de hilos
+    map<int, double> peak, bw;
+    const size_t stream_elems = (size_t)opt.get_int("stream-mb", 256) * (1 << 20) / 12;
+    set<int> roof_threads(thread_list.begin(), thread_list.end());
+    roof_threads.insert(1);  // las variantes secuenciales se comparan con el techo de 1 hilo
+    for (int T : roof_threads) {
+        peak[T] = measure_peak_gflops(g_kernel, T);
+        bw[T] = measure_stream_gbs(stream_elems, T, 5);
+        cerr << "Techo hilos=" << T << ": " << fixed << setprecision(1) << peak[T] << " GFLOP/s (" << g_kernel.name
+             << ")  " << bw[T] << " GB/s (STREAM triad)\n";
+    }
+
+    vector<BenchRow> rows;
+    // GFLOP/s y hilos de la corrida con menos hilos de cada (variante, N), base de la eficiencia
+    map<pair<string, int>, pair<double, int>> base;
+    for (int N : sizes) {
+        BenchData d{N, Matrix((size_t)N * N), Matrix((size_t)N * N), Matrix((size_t)N * N)};
+        first_touch_fill_random(d.A, N, N, 1, hw);
+        first_touch_fill_random(d.B, N, N, 2, hw);
+        first_touch_fill(d.C, N, N, 0.0f, hw);
+        // Tráfico mínimo: leer A y B y escribir C una vez
+        const double bytes = 3.0 * N * (double)N * sizeof(float), flops = 2.0 * N * (double)N * N;
+        for (const auto& v : variants) {
+            if (v.max_n > 0 && N > v.max_n) continue;
+            function<void(int)> run = v.make(d);
+            for (int T : thread_list) {
+                if (!v.parallel && T != thread_list.front()) continue;
+                run(T);  // calentamiento
+                vector<double> times;
+                for (int r = 0; r < reps; ++r) {
+                    auto t0 = Clock::now();
+                    run(T);
+                    times.push_back(chrono::duration_cast<ms>(Clock::now() - t0).count());
+                }
+                sort(times.begin(), times.end());
+                BenchRow row;
+                row.variant = v.name;
+                row.N = N;
+                row.threads = v.parallel ? T : 1;
+                row.reps = reps;
+                row.ms_min = times.front();
+                row.ms_med = times[times.size() / 2];
+                row.gflops = flops / (row.ms_min * 1e6);
+                row.gbs = bytes / (row.ms_min * 1e6);
+                row.intensity = flops / bytes;
+                const double pk = peak[row.threads], bwT = bw[row.threads];
+                row.roof_gflops = min(pk, row.intensity * bwT);
+                row.roof_pct = 100.0 * row.gflops / row.roof_gflops;
+                const auto& b = base.emplace(make_pair(v.name, N), make_pair(row.gflops, row.threads)).first->second;
+                row.efficiency = row.gflops * b.second / (row.threads * b.first);
+                rows.push_back(row);
+                cerr << "  " << setw(22) << left << v.name << right << " N=" << setw(5) << N << " hilos=" << setw(3)
+                     << row.threads << "  " << setw(8) << row.gflops << " GFLOP/s  " << setw(5) << row.roof_pct
+                     << "% del techo\n";
+            }
+        }
+    }
+
+    ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path);
+        if (!file) { cerr << "No se pudo abrir " << out_path << "\n"; return 1; }
+    }
+    ostream& out = out_path.empty() ? cout : file;
+    out << setprecision(6) << defaultfloat;
+    if (format == "json") {
+        const MachineInfo mi = detect_machine();
+        out << "{\n  \"maquina\": {\"cpu\": \"" << mi.model << "\", \"cpus\": " << mi.logical
+            << ", \"nucleos\": " << mi.physical << ", \"kernel\": \"" << g_kernel.name << "\"},\n  \"techo\": [";
+        bool first = true;
+        for (int T : roof_threads) {
+            out << (first ? "" : ", ") << "{\"hilos\": " << T << ", \"gflops\": " << peak[T] << ", \"gbs\": " << bw[T] << "}";
+            first = false;
+        }
+        out << "],\n  \"resultados\": [\n";
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const BenchRow& r = rows[i];
+            out << "    {\"variante\": \"" << r.variant << "\", \"N\": " << r.N << ", \"hilos\": " << r.threads
+                << ", \"repeticiones\": " << r.reps << ", \"ms_min\": " << r.ms_min << ", \"ms_mediana\": " << r.ms_med
+                << ", \"gflops\": " << r.gflops << ", \"gbs\": " << r.gbs << ", \"intensidad\": " << r.intensity
+                << ", \"techo_gflops\": " << r.roof_gflops << ", \"pct_techo\": " << r.roof_pct
+                << ", \"eficiencia\": " << r.efficiency << "}" << (i + 1 < rows.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    } else {
+        out << "variante,N,hilos,repeticiones,ms_min,ms_mediana,gflops,gbs,intensidad,techo_gflops,pct_techo,eficiencia\n";
+        for (const BenchRow& r : rows)
+            out << r.variant << "," << r.N << "," << r.threads << "," << r.reps << "," << r.ms_min << ","
+                << r.ms_med << "," << r.gflops << "," << r.gbs << "," << r.intensity << "," << r.roof_gflops << ","
+                << r.roof_pct << "," << r.efficiency << "\n";
+    }
+    return 0;
+}
+
+template <class T>
+static T random_elem(uint64_t seed, uint64_t idx) {
+    if constexpr (is_complex_t<T>::value) {
+        using R = typename T::value_type;
+        return T((R)hashed_value(seed, 2 * idx), (R)hashed_value(seed, 2 * idx + 1));
+    } else {
+        return (T)hashed_value(seed, idx);
+    }
+}
+
+// Corre un tipo: camino especializado vs micro-kernel genérico, y error contra i-k-j
+template <class T>
+static void run_typed_case(const char* label, int M, int K, int N, int num_threads, bool use_3m, bool check) {
+    avec<T> A((size_t)M * K), B((size_t)K * N), C((size_t)M * N), Cg((size_t)M * N);
+    for (size_t i = 0; i < A.size(); ++i) A[i] = random_elem<T>(1, i);
+    for (size_t i = 0; i < B.size(); ++i) B[i] = random_elem<T>(2, i);
+    const double flops = (is_complex_t<T>::value ? 8.0 : 2.0) * M * (double)N * K;
+
+    gemm_typed<T>(M, N, K, A.data(), B.data(), C.data(), num_threads, use_3m);  // calentamiento
+    auto t0 = Clock::now();
+    const sum_t<T> sum = gemm_typed<T>(M, N, K, A.data(), B.data(), C.data(), num_threads, use_3m);
+    const double ms_s = chrono::duration_cast<ms>(Clock::now() - t0).count();
+    gemm_typed<T>(M, N, K, A.data(), B.data(), Cg.data(), num_threads, use_3m, true);
+    auto t1 = Clock::now();
+    gemm_typed<T>(M, N, K, A.data(), B.data(), Cg.data(), num_threads, use_3m, true);
+    const double ms_g = chrono::duration_cast<ms>(Clock::now() - t1).count();
+
+    cout << fixed << setprecision(3) << setw(19) << left << label << right
+         << "  " << setw(9) << ms_s << " ms  " << setw(8) << flops / (ms_s * 1e6) << " GFLOP/s"
+         << "  (genérico " << flops / (ms_g * 1e6) << ")  sumatoria=" << sum;
+    if (check) {
+        // Referencia i-k-j en el mismo tipo
+        vector<T> ref((size_t)M * N, T(0));
+        for (int i = 0; i < M; ++i)
+            for (int k = 0; k < K; ++k) {
+                const T a = A[(size_t)i * K + k];
+                for (int j = 0; j < N; ++j) ref[(size_t)i * N + j] += a * B[(size_t)k * N + j];
+            }
+        double err = 0.0, nrm = 0.0;
+        for (size_t i = 0; i < ref.size(); ++i) {
+            err += norm(complex<double>(C[i]) - complex<double>(ref[i]));
+            nrm += norm(complex<double>(ref[i]));
+        }
+        cout << scientific << setprecision(2) << "  error rel.=" << sqrt(err / max(1e-300, nrm));
+    }
+    cout << "\n";
+}
+
+// --modo=tipos: float, double, complex<float> y complex<double> (3M y/o 4M)
+static int run_typed_mode(int M, int K, int N, int num_threads, const Options& opt) {
+    const string method = opt.get("metodo", "ambos");
+    const bool check = !opt.has("sin-verificar") && (double)M * N * K <= (double)(1 << 30);
+    cout << "Modo tipos: float=" << g_kernel.name << "  double=" << real_kernel<double>().name
+         << "  (GFLOP/s efectivos: 8 flops por producto complejo)\n";
+    run_typed_case<float>("float", M, K, N, num_threads, true, check);
+    run_typed_case<double>("double", M, K, N, num_threads, true, check);
+    for (bool use_3m : {true, false}) {
+        if ((use_3m && method == "4m") || (!use_3m && method == "3m")) continue;
+        run_typed_case<complex<float>>(use_3m ? "complex<float> 3M" : "complex<float> 4M", M, K, N, num_threads, use_3m, check);
+        run_typed_case<complex<double>>(use_3m ? "complex<double> 3M" : "complex<double> 4M", M, K, N, num_threads, use_3m, check);
+    }
+    return 0;
+}
+
+// --modo=summa: lanza P procesos locales (fork) conectados por TCP o memoria
+// compartida; con --rango=r --hosts=h0:p0,h1:p1,... corre sólo el proceso r
+// (uno por nodo, TCP).
+static int run_summa_mode(int M, int K, int N, int num_threads, const Options& opt, float a_val, float b_val) {
+    SummaConfig cfg;
+    cfg.M = M; cfg.K = K; cfg.N = N;
+    cfg.panel = max(1, (int)opt.get_int("panel", 256));
+    cfg.threads = max(1, (int)opt.get_int("hilos-proceso", 1));
+    cfg.random = opt.has("aleatorio");
+    cfg.verify = !opt.has("sin-verificar");
+    cfg.a_val = a_val; cfg.b_val = b_val;
+    const string transport = opt.get("transporte", "tcp");
+    (void)num_threads;
+
+    vector<string> hosts;
+    if (opt.has("hosts")) {
+        stringstream ss(opt.get("hosts"));
+        for (string h; getline(ss, h, ',');) if (!h.empty()) hosts.push_back(h);
+    }
+    const int P = hosts.empty() ? max(1, (int)opt.get_int("procesos", 4)) : (int)hosts.size();
+    tie(cfg.pr, cfg.pc) = process_grid(P);
+    if (hosts.empty()) {
+        const int base = (int)opt.get_int("puerto", 41000 + getpid() % 10000);
+        for (int r = 0; r < P; ++r) hosts.push_back("127.0.0.1:" + to_string(base + r));
+    }
+
+    // Un solo proceso de un despliegue multi-nodo
+    if (opt.has("rango")) {
+        const int rank = (int)opt.get_int("rango", 0);
+        try {
+            auto ch = tcp_mesh(rank, hosts);
+            return summa_worker(rank, cfg, ch);
+        } catch (const exception& e) {
+            cerr << "rango " << rank << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    cout << "Modo SUMMA: " << P << " procesos en grilla " << cfg.pr << "x" << cfg.pc << "  panel=" << cfg.panel
+         << "  transporte=" << transport << "  datos=" << (cfg.random ? "aleatorios" : "constantes") << "\n";
+    if (transport != "tcp" && transport != "shm") {
+        cerr << "Transporte desconocido: " << transport << " (tcp o shm)\n";
+        return 1;
+    }
+
+    // Anillos compartidos: uno por par ordenado (origen, destino), creados antes del fork
+    ShmRing* rings = nullptr;
+    const size_t ring_bytes = sizeof(ShmRing) * (size_t)P * P;
+    if (transport == "shm") {
+        void* mem = mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) { perror("mmap"); return 1; }
+        rings = (ShmRing*)mem;
+        for (int i = 0; i < P * P; ++i) {
+            new (&rings[i].head) atomic<uint64_t>(0);
+            new (&rings[i].tail) atomic<uint64_t>(0);
+        }
+    }
+
+    cout.flush();
+    vector<pid_t> pids;
+    for (int rank = 0; rank < P; ++rank) {
+        const pid_t pid = fork();
+        if (pid < 0) { perror("fork"); return 1; }
+        if (pid == 0) {
+            int code = 1;
+            try {
+                vector<unique_ptr<Channel>> ch;
+                if (rings) {
+                    ch.resize(P);
+                    for (int peer = 0; peer < P; ++peer)
+                        if (peer != rank) ch[peer] = make_unique<ShmChannel>(&rings[rank * P + peer], &rings[peer * P + rank]);
+                } else {
+                    ch = tcp_mesh(rank, hosts);
+                }
+                code = summa_worker(rank, cfg, ch);
+            } catch (const exception& e) {
+                cerr << "rango " << rank << ": " << e.what() << "\n";
+            }
+            cout.flush();
+            _exit(code);
+        }
+        pids.push_back(pid);
+    }
+
+    int failures = 0;
+    for (pid_t pid : pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failures;
+    }
+    if (rings) munmap(rings, ring_bytes);
+    if (failures) cerr << failures << " proceso(s) terminaron con error\n";
+    return failures ? 1 : 0;
+}
+
+// --modo=archivo: C = A·B con A y B leídos de archivo (.npy o .mat, vía mmap);
+// --c guarda C. --generar=MxKxN escribe antes A y B aleatorias en esas rutas.
+static int run_file_mode(const Options& opt, int num_threads) {
+    const string pa = opt.get("a", "A.npy"), pb = opt.get("b", "B.npy"), pc = opt.get("c", "");
+    num_threads = max(1, (int)opt.get_int("hilos", num_threads));
+    cout << fixed << setprecision(3);
+    try {
+        if (opt.has("generar")) {
+            int M, K, N;
+            if (!parse_shape(opt.get("generar"), M, K, N)) {
+                cerr << "--generar debe ser N o MxKxN\n";
+                return 1;
+            }
+            Matrix A((size_t)M * K), B((size_t)K * N);
+            first_touch_fill_random(A, M, K, 1, num_threads);
+            first_touch_fill_random(B, K, N, 2, num_threads);
+            save_matrix(pa, A.data(), M, K, num_threads);
+            save_matrix(pb, B.data(), K, N, num_threads);
+            cout << "Generadas " << pa << " (" << M << "x" << K << ") y " << pb << " (" << K << "x" << N << ")\n";
+        }
+
+        auto t0 = Clock::now();
+        MappedMatrix A(pa, num_threads), B(pb, num_threads);
+        const double ms_load = chrono::duration_cast<ms>(Clock::now() - t0).count();
+        const int M = A.rows(), K = A.cols(), N = B.cols();
+        if (B.rows() != K) {
+            cerr << "Dimensiones incompatibles: A es " << M << "x" << K << " y B es " << B.rows() << "x" << N << "\n";
+            return 1;
+        }
+        auto describe = [](const MappedMatrix& X) {
+            const MatrixFileInfo& f = X.file();
+            return string(f.npy ? "npy " : "mat ") + (f.dtype == FileDtype::F64 ? "f64 " : "f32 ") +
+                   (f.col_major ? "col-mayor" : "fila-mayor") + (X.zero_copy() ? ", sin copia" : ", convertida");
+        };
+        cout << "A: " << pa << " " << M << "x" << K << " (" << describe(A) << ")\n";
+        cout << "B: " << pb << " " << K << "x" << N << " (" << describe(B) << ")\n";
+        cout << "Carga: " << ms_load << " ms  hilos=" << num_threads << "\n";
+
+        Matrix C((size_t)M * N);
+        first_touch_fill(C, M, N, 0.0f, num_threads);
+        auto t1 = Clock::now();
+        const double sum = gemm_parallel_tiles(M, N, K, A.data(), B.data(), C.data(), num_threads);
+        const double ms_mul = chrono::duration_cast<ms>(Clock::now() - t1).count();
+        cout << "Sumatoria = " << sum << "\n";
+        cout << "Tiempo: " << ms_mul << " ms  " << gflops(M, K, N, ms_mul) << " GFLOP/s\n";
+
+        int rc = 0;
+        if (!opt.has("sin-verificar")) {
+            const double p_error = stod(opt.get("prob-error", "1e-9"));
+            const FreivaldsResult f = freivalds_verify(A.data(), B.data(), C.data(), M, K, N, p_error, num_threads,
+                                                       random_device{}(), stod(opt.get("tolerancia", "8")));
+            print_freivalds(f, p_error);
+            rc = f.ok ? 0 : 1;
+        }
+        if (!pc.empty()) {
+            auto t2 = Clock::now();
+            save_matrix(pc, C.data(), M, N, num_threads);
+            const double ms_save = chrono::duration_cast<ms>(Clock::now() - t2).count();
+            cout << "C guardada en " << pc << ": " << ms_save << " ms ("
+                 << (double)M * N * sizeof(float) / (1 << 20) / max(1e-9, ms_save / 1000.0) << " MiB/s)\n";
+        }
+        return rc;
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+// --modo=morton: fila-mayor por tiles vs Morton + recursión, para varios tamaños de hoja
+static int run_morton_mode(int M, int K, int N, int num_threads, const Options& opt) {
+    const vector<int> leaves = parse_int_list(opt.get("hojas", "64,128,256"));
+    const int reps = max(1, (int)opt.get_int("repeticiones", 3));
+    cout << "Modo Morton (orden Z) vs fila-mayor, mejor de " << reps << " repeticiones\n";
+
+    Matrix A((size_t)M * K), B((size_t)K * N), C((size_t)M * N), C2((size_t)M * N);
+    first_touch_fill_random(A, M, K, 1, num_threads);
+    first_touch_fill_random(B, K, N, 2, num_threads);
+    first_touch_fill(C, M, N, 0.0f, num_threads);
+    first_touch_fill(C2, M, N, 0.0f, num_threads);
+
+    auto best_of = [&](auto&& fn) {
+        double best = 1e300;
+        for (int r = 0; r < reps; ++r) {
+            auto t0 = Clock::now();
+            fn();
+            best = min(best, chrono::duration_cast<ms>(Clock::now() - t0).count());
+        }
+        return best;
+    };
+    const double ms_row = best_of([&] { gemm_parallel_tiles(M, N, K, A.data(), B.data(), C.data(), num_threads); });
+    cout << fixed << setprecision(3);
+    cout << "fila-mayor (tiles " << g_blk.MC << "/" << g_blk.KC << "/" << g_blk.NC << "): " << ms_row << " ms  "
+         << gflops(M, K, N, ms_row) << " GFLOP/s\n";
+
+    cout << "   hoja  niveles  relleno   conv. A+B    multiplicar    conv. C   GFLOP/s (mult.)  GFLOP/s (total)  error máx.\n";
+    for (int leaf : leaves) {
+        if (leaf <= 0) continue;
+        const MortonLayout ml = morton_layout(M, K, N, leaf);
+        avec<float> Am(ml.leaf_a() * ml.tiles()), Bm(ml.leaf_b() * ml.tiles()), Cm(ml.leaf_c() * ml.tiles());
+        const double ms_in = best_of([&] {
+            to_morton(A.data(), M, K, ml.L, ml.tm, ml.tk, Am.data(), num_threads);
+            to_morton(B.data(), K, N, ml.L, ml.tk, ml.tn, Bm.data(), num_threads);
+        });
+        const double ms_mul = best_of([&] { morton_multiply(ml, Am.data(), Bm.data(), Cm.data(), num_threads); });
+        const double ms_out = best_of([&] { from_morton(Cm.data(), M, N, ml.L, ml.tm, ml.tn, C2.data(), num_threads); });
+
+        double max_abs = 0.0;
+        for (size_t i = 0; i < C.size(); ++i) max_abs = max(max_abs, (double)fabs(C[i] - C2[i]));
+        const double pad = (double)ml.leaf_c() * ml.tiles() / ((double)M * N);
+        cout << setw(7) << leaf << setw(9) << ml.L << setw(8) << pad << "x" << setw(10) << ms_in << " ms"
+             << setw(11) << ms_mul << " ms" << setw(8) << ms_out << " ms" << setw(15) << gflops(M, K, N, ms_mul)
+             << setw(17) << gflops(M, K, N, ms_in + ms_mul + ms_out) << scientific << setprecision(2) << setw(14)
+             << max_abs << fixed << setprecision(3) << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    const Options opt = parse_options(argc, argv);
+    const vector<string>& pos = opt.positional;
+    const string mode = opt.get("modo");
+
+    // Páginas enormes para matrices y buffers de empaquetado (antes de reservar nada)
+    const string pages = opt.get("paginas", "thp");
+    if (pages == "no") g_hugepages = HugePages::Off;
+    else if (pages == "explicitas") g_hugepages = HugePages::Explicit;
+    else if (pages != "thp") {
+        cerr << "--paginas debe ser no, thp o explicitas\n";
+        return 1;
+    }
+
+    if (mode == "tunear") return run_tune_mode(opt);
+
+    // Perfil de auto-ajuste (si existe y es de esta máquina)
+    TuneProfile prof;
+    bool prof_ok = false;
+    const string prof_path = opt.get("perfil", default_profile_path());
+    if (!opt.has("sin-perfil") && load_profile(prof_path, prof)) {
+        string why;
+        prof_ok = apply_profile(prof, why);
+        if (!prof_ok) cerr << "Perfil " << prof_path << " ignorado: " << why << "\n";
+        else if (!why.empty()) cerr << "Perfil " << prof_path << " aplicado en parte: " << why << "\n";
+    }
+
+    if (mode == "bench") return run_bench_mode(opt);
+    if (mode == "archivo") {
+        int hw = (int)thread::hardware_concurrency(); if (hw <= 0) hw = 8;
+        return run_file_mode(opt, prof_ok && prof.threads > 0 ? prof.threads : min(20, hw));
+    }
+
+    if (pos.empty()) {
+        cerr << "Uso: " << argv[0] << " N|MxKxN [hilos] [valorA] [valorB] [--modo=...]\n";
+        cerr << "Ej.: " << argv[0] << " 3000 16 0.1 0.2   |   " << argv[0] << " 2000x500x3000 16\n";
+        cerr << "Modos:\n";
+        cerr << "  --modo=strassen [--cutoff=1024] [--aleatorio]   Strassen-Winograd vs clásico\n";
+        cerr << "  --modo=precision [--aleatorio]                  bf16 / fp16 / int8 vs fp32\n";
+        cerr << "  --modo=lote [--cantidad=10000] [--forma=MxKxN|variada]  GEMM por lotes\n";
+        cerr << "  --modo=disperso [--densidad=0.01] [--bs=4] [--bloque=1] [--sesgado] [--umbral=0.1]\n"
+             << "                                                  SpMV / SpMM CSR y BSR vs densa\n";
+        cerr << "  --modo=disco [--dir=/tmp/matmul_disco] [--memoria=256] [--aleatorio] [--reusar] [--verificar]\n"
+             << "                                                  GEMM fuera de memoria (MiB de presupuesto)\n";
+        cerr << "  --modo=sgemm [--alpha=1.5] [--beta=-0.5] [--relleno=3]  interfaz BLAS: layouts y transpuestas\n";
+        cerr << "  --modo=epilogo [--activacion=relu|gelu|ninguna] [--escala=1]  epílogos fusionados\n";
+        cerr << "  --modo=tipos [--metodo=3m|4m|ambos] [--sin-verificar]  double y complejos (3M/4M)\n";
+        cerr << "  --modo=morton [--hojas=64,128,256] [--repeticiones=3]  orden Z recursivo vs fila-mayor\n";
+        cerr << "  --modo=summa [--procesos=4] [--transporte=tcp|shm] [--panel=256] [--aleatorio]\n"
+             << "               [--rango=r --hosts=h0:p0,h1:p1,...]  SUMMA en procesos (grilla 2D)\n";
+        cerr << "  --modo=archivo --a=A.npy --b=B.npy [--c=C.npy] [--hilos=T] [--generar=MxKxN] [--sin-verificar]\n"
+             << "                                                  A y B desde .npy / .mat (mmap), C a archivo\n";
+        cerr << "  --modo=tunear [--tamanos=512,1024,2048] [--presupuesto-s=120] [--perfil=ruta]\n"
+             << "                                                  busca la mejor configuración y la guarda\n";
+        cerr << "  --modo=bench [--tamanos=256,512,1024,2048] [--hilos=1,2,4] [--repeticiones=3]\n"
+             << "               [--variantes=ikj,paralelo,...] [--formato=csv|json] [--salida=archivo]\n"
+             << "                                                  suite no interactiva con techo (roofline)\n";
+        cerr << "Verificación: --verificar=serie (por defecto) | freivalds [--prob-error=1e-9] [--tolerancia=8] [--semilla=S]\n";
+        cerr << "Páginas: --paginas=thp (por defecto) | explicitas (MAP_HUGETLB) | no\n";
+        cerr << "Perfil: " << default_profile_path() << " (MATMUL_PERFIL o --perfil=ruta; --sin-perfil lo ignora)\n";
+        return 1;
+    }
+
+    int M = 0, K = 0, N = 0;
+    if (!parse_shape(pos[0], M, K, N)) {
+        cerr << "Tamaño inválido: " << pos[0] << " (use N o MxKxN)\n";
+        return 1;
+    }
+    int hw = (int)thread::hardware_concurrency(); if (hw <= 0) hw = 8;
+    int num_threads = (pos.size() >= 2) ? stoi(pos[1]) : (prof_ok && prof.threads > 0 ? prof.threads : min(20, hw));
+    float a_val = (pos.size() >= 3) ? (float)atof(pos[2].c_str()) : 0.1f;
+    float b_val = (pos.size() >= 4) ? (float)atof(pos[3].c_str()) : 0.2f;
+
+    if (prof_ok) {
+        cout << "Perfil " << prof_path << ": " << g_kernel.name << "  MC=" << g_blk.MC << " KC=" << g_blk.KC
+             << " NC=" << g_blk.NC << "  hilos=" << prof.threads << "\n";
+    }
+    if (mode == "lote") return run_batch_mode(num_threads, opt);
+
+    if (M == N && K == N) cout << "N=" << N;
+    else cout << "M=" << M << "  K=" << K << "  N=" << N;
+    cout << "  hilos=" << num_threads << "  A=" << a_val << "  B=" << b_val << "\n";
+
+    if ((mode == "strassen" || mode == "precision") && !(M == N && K == N)) {
+        cerr << "El modo " << mode << " requiere matrices cuadradas\n";
+        return 1;
+    }
+    if (mode == "strassen") return run_strassen_mode(N, num_threads, opt, a_val, b_val);
+    if (mode == "precision") return run_precision_mode(N, num_threads, opt, a_val, b_val);
+    if (mode == "disperso") return run_sparse_mode(M, K, N, num_threads, opt);
+    if (mode == "disco") return run_ooc_mode(M, K, N, num_threads, opt, a_val, b_val);
+    if (mode == "sgemm") return run_sgemm_mode(M, K, N, num_threads, opt);
+    if (mode == "epilogo") return run_epilogue_mode(M, K, N, num_threads, opt);
+    if (mode == "tipos") return run_typed_mode(M, K, N, num_threads, opt);
+    if (mode == "morton") return run_morton_mode(M, K, N, num_threads, opt);
+    if (mode == "summa") return run_summa_mode(M, K, N, num_threads, opt, a_val, b_val);
+    if (!mode.empty()) {
+        cerr << "Modo desconocido: " << mode << "\n";
+        return 1;
+    }
+
+    // Reserva sin tocar páginas + inicialización paralela (first touch NUMA)
+    Matrix A((size_t)M * K), B((size_t)K * N), C((size_t)M * N);
+    first_touch_fill(A, M, K, a_val, num_threads);
+    first_touch_fill(B, K, N, b_val, num_threads);
+    first_touch_fill(C, M, N, 0.0f, num_threads);
+    print_huge_page_report();
+
+    print_corners("A", corners_of(A, M, K));
+    print_corners("B", corners_of(B, K, N));
+
+    auto wait_enter = [&](const string& msg){
+        cout << msg; cout.flush();
+        string line; getline(cin, line);
+    };
+
+    // Verificación: re-ejecutar la versión secuencial (O(N³)) o Freivalds (O(N²))
+    const string verify = opt.get("verificar", "serie");
+    if (verify != "serie" && verify != "freivalds") {
+        cerr << "--verificar debe ser serie o freivalds\n";
+        return 1;
+    }
+    const bool use_freivalds = verify == "freivalds";
+    const double p_error = stod(opt.get("prob-error", "1e-9"));
+
+    cout << fixed << setprecision(6);
+    double sum_seq = 0.0, ms_seq = 0.0, sum_blk = 0.0;
+    if (!use_freivalds) {
+        // ---- Pausa antes de ejecutar SECUENCIAL ----
+        wait_enter("\nPresione ENTER para ejecutar la versión SECUENCIAL...");
+        auto t0 = Clock::now();
+        sum_seq = matmul_serial_sum(C, A, B, M, K, N);
+        auto t1 = Clock::now();
+        ms_seq = chrono::duration_cast<ms>(t1 - t0).count();
+
+        print_corners("C (secuencial)", corners_of(C, M, N));
+        cout << "Sumatoria (secuencial) = " << sum_seq << "\n";
+        cout << "Tiempo secuencial: " << ms_seq/1000.0 << " s (" << ms_seq << " ms)\n";
+        cout << "GFLOP/s (secuencial) = " << gflops(M, K, N, ms_seq) << "\n";
+
+        // ---- Pausa antes de ejecutar SECUENCIAL POR BLOQUES ----
+        wait_enter("\nPresione ENTER para ejecutar la versión SECUENCIAL POR BLOQUES...");
+        cout << "Bloques: MC=" << g_blk.MC << "  KC=" << g_blk.KC << "  NC=" << g_blk.NC
+             << "  micro-kernel " << g_kernel.name << "\n";
+        auto tb0 = Clock::now();
+        sum_blk = matmul_blocked_sum(C, A, B, M, K, N);
+        auto tb1 = Clock::now();
+        double ms_blk = chrono::duration_cast<ms>(tb1 - tb0).count();
+
+        print_corners("C (bloques)", corners_of(C, M, N));
+        cout << "Sumatoria (bloques) = " << sum_blk << "\n";
+        cout << "Tiempo por bloques: " << ms_blk/1000.0 << " s (" << ms_blk << " ms)\n";
+        cout << "GFLOP/s (bloques) = " << gflops(M, K, N, ms_blk)
+             << "  (x" << (ms_blk > 0.0 ? ms_seq / ms_blk : 0.0) << " vs i-k-j)\n";
+    }
+
+    // ---- Pausa antes de ejecutar MULTIHILO ----
+    wait_enter("\nPresione ENTER para ejecutar la versión MULTIHILO...");
+    auto t2 = Clock::now();
+    double sum_par = matmul_parallel_sum(C, A, B, M, K, N, num_threads);
+    auto t3 = Clock::now();
+    double ms_par = chrono::duration_cast<ms>(t3 - t2).count();
+
+    print_corners("C (multihilo)", corners_of(C, M, N));
+    cout << "Sumatoria (multihilo) = " << sum_par << "\n";
+    cout << "Tiempo multihilo: " << ms_par/1000.0 << " s (" << ms_par << " ms)\n";
+    cout << "GFLOP/s (multihilo) = " << gflops(M, K, N, ms_par) << "\n";
+    cout << "Tiles " << g_sched_stats.tile_m << "x" << g_sched_stats.tile_n
+         << ": " << g_sched_stats.tiles << "  robados: " << g_sched_stats.steals
+         << "  hilos fijados a CPU: " << (g_sched_stats.pinned ? "sí" : "no") << "\n";
+
+    if (use_freivalds) {
+        const uint64_t seed = opt.has("semilla") ? (uint64_t)opt.get_int("semilla", 0) : random_device{}();
+        const double tau = stod(opt.get("tolerancia", "8"));
+        const FreivaldsResult f = freivalds_verify(A.data(), B.data(), C.data(), M, K, N, p_error, num_threads, seed, tau);
+        print_freivalds(f, p_error);
+        if (!f.ok) return 1;
+    } else {
+        double rel_diff = fabs(sum_seq - sum_par) / max(1.0, fabs(sum_seq));
+        if (rel_diff > 1e-5) {
+            cout << "ADVERTENCIA: diferencia relativa entre sumatorias = " << rel_diff << "\n";
+        }
+        double rel_diff_blk = fabs(sum_seq - sum_blk) / max(1.0, fabs(sum_seq));
+        if (rel_diff_blk > 1e-5) {
+            cout << "ADVERTENCIA: diferencia relativa (bloques) = " << rel_diff_blk << "\n";
+        }
     }
 
-    if (ms_par > 0.0) {
+    if (ms_par > 0.0 && ms_seq > 0.0) {
         double speedup = ms_seq / ms_par;
         cout << "Speedup = " << speedup << "x\n";
     }
 
-    double esperado = (double)N * N * (double)(N * a_val * b_val);
+    double esperado = (double)M * N * (double)(K * a_val * b_val);
     cout << "\n(Referencia teórica con matrices constantes) "
-         << "elemento C[i,j]≈" << (N * a_val * b_val)
+         << "elemento C[i,j]≈" << (K * a_val * b_val)
          << "  sumatoria≈" << esperado << "\n";
 
     return 0;
@@ -1,4 +1,4 @@
-// primes_var.cpp
+// primes.cpp
 #include <bits/stdc++.h>
 #include <thread>
 #include <atomic>
@@ -52,47 +52,15 @@ static PrimeStats primes_sequential(long long N) {
     return st;
 }
 
-// ----------------- MULTIHILO: INTERVALOS VARIABLES + COLA DINÁMICA -----------------
+// ----------------- MULTIHILO: PARTICIÓN ESTÁTICA -----------------
+// Línea de base: [2, N-1] se divide en T intervalos contiguos de igual tamaño,
+// uno por hilo, sin ningún reparto dinámico. Cada hilo criba su intervalo por
+// bloques de SEG números (para no reservar el intervalo entero de una vez).
 struct ThreadResult {
     unsigned long long count = 0;
-    vector<long long> tails; // colecciona hasta 10 de cada bloque
+    vector<long long> tails; // hasta 10 mayores del intervalo (desc)
 };
 
-// Tamaño de bloque “creciente” con la posición (no constante).
-static inline long long tile_len_for(long long lo, long long end, long long total) {
-    // f ∈ [0,1]: progreso del rango
-    double f = (total > 0) ? double(lo - 2) / double(total) : 0.0;
-    // Límites de tamaño de bloque (en cantidad de números)
-    const long long MIN_TILE = 1LL << 18; // 262,144
-    const long long MAX_TILE = 1LL << 21; // 2,097,152
-    long long len = (long long)(MIN_TILE + (MAX_TILE - MIN_TILE) * f);
-    if (len < MIN_TILE) len = MIN_TILE;
-    if (len > MAX_TILE) len = MAX_TILE;
-    // Ajuste si nos pasamos del final
-    if (lo + len - 1 > end) len = end - lo + 1;
-    return max(0LL, len);
-}
-
-static bool claim_next_chunk(atomic<long long>& cursor, long long end, long long total,
-                             long long& lo, long long& hi)
-{
-    while (true) {
-        long long cur = cursor.load(memory_order_relaxed);
-        if (cur > end) return false;
-
-        long long len = tile_len_for(cur, end, total);
-        if (len <= 0) return false;
-
-        long long next = cur + len;
-        if (cursor.compare_exchange_weak(cur, next, memory_order_acq_rel, memory_order_relaxed)) {
-            lo = cur;
-            hi = cur + len - 1;
-            return true;
-        }
-        // Si falla el CAS, reintentar.
-    }
-}
-
 static void sieve_segment(long long lo, long long hi,
                           const vector<int>& base_primes,
                           unsigned long long& count_out,
@@ -116,4 +84,128 @@ static void sieve_segment(long long lo, long long hi,
 
     // Guardar hasta 10 mayores del bloque
     for (long long j = hi; j >= lo && (int)tail_out.size() < 10; --j) {
-        if (seg[(size_t_]()
+        if (seg[(size_t)(j - lo)]) tail_out.push_back(j);
+    }
+}
+
+static PrimeStats primes_parallel_static(long long N, int num_threads) {
+    num_threads = max(1, num_threads);
+
+    // Primos base (<= sqrt(N))
+    vector<int> base = sieve_base((long long)floor(sqrt((long double)N)));
+
+    // Rango global [2, N-1]
+    const long long BEGIN = 2;
+    const long long END   = N - 1;
+    const long long TOTAL = max(0LL, END - BEGIN + 1);
+    const long long SEG   = 1LL << 21;
+
+    vector<thread> ths;
+    vector<ThreadResult> accum(num_threads);
+
+    auto worker = [&](int tid) {
+        const long long lo = BEGIN + TOTAL * tid / num_threads;
+        const long long hi = BEGIN + TOTAL * (tid + 1) / num_threads - 1;
+        unsigned long long local_count = 0;
+        vector<long long> tails;
+
+        // De atrás hacia adelante: los 10 mayores salen de los últimos bloques
+        for (long long s_hi = hi; s_hi >= lo; s_hi -= SEG) {
+            const long long s_lo = max(lo, s_hi - SEG + 1);
+            unsigned long long c = 0;
+            vector<long long> tail;
+            sieve_segment(s_lo, s_hi, base, c, tail);
+            local_count += c;
+            for (long long v : tail) if (tails.size() < 10) tails.push_back(v);
+        }
+        accum[tid].count = local_count;
+        accum[tid].tails = move(tails);
+    };
+
+    for (int t = 0; t < num_threads; ++t) ths.emplace_back(worker, t);
+    for (auto& h : ths) h.join();
+
+    PrimeStats st;
+    for (auto& r : accum) st.count += r.count;
+
+    vector<long long> all;
+    for (auto& r : accum) all.insert(all.end(), r.tails.begin(), r.tails.end());
+    sort(all.begin(), all.end(), greater<long long>());
+    for (size_t i = 0; i < all.size() && i < 10; ++i) st.top10_desc.push_back(all[i]);
+
+    return st;
+}
+
+static void print_top10(const vector<long long>& v) {
+    cout << "Top 10 primos (desc): ";
+    if (v.empty()) { cout << "(ninguno)\n"; return; }
+    for (size_t i = 0; i < v.size(); ++i) {
+        if (i) cout << ' ';
+        cout << v[i];
+    }
+    cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    long long N = 0;
+    if (argc >= 2) {
+        N = atoll(argv[1]);
+    } else {
+        cout << "Ingrese N (>= 10000000): ";
+        if (!(cin >> N)) {
+            cerr << "Entrada inválida.\n";
+            return 1;
+        }
+        string dummy; getline(cin, dummy);
+    }
+    if (N < 2) {
+        cerr << "N debe ser >= 2.\n";
+        return 1;
+    }
+
+    int hw = (int)thread::hardware_concurrency();
+    if (hw <= 0) hw = 8;
+    int num_threads = (argc >= 3) ? stoi(argv[2]) : min(20, hw);
+
+    cout << "N=" << N << "  hilos=" << num_threads << "\n";
+
+    // -------- Secuencial --------
+    wait_enter("\nPresione ENTER para ejecutar la versión SECUENCIAL...");
+    auto t0 = Clock::now();
+    PrimeStats seq = primes_sequential(N);
+    auto t1 = Clock::now();
+    double ms_seq = chrono::duration_cast<ms>(t1 - t0).count();
+
+    cout << "\n[SECUENCIAL]\n";
+    cout << "Cantidad de primos < N: " << seq.count << "\n";
+    print_top10(seq.top10_desc);
+    cout << fixed << setprecision(3)
+         << "Tiempo secuencial: " << ms_seq/1000.0 << " s (" << ms_seq << " ms)\n";
+
+    // -------- Paralelo (partición estática) --------
+    wait_enter("\nPresione ENTER para ejecutar la versión MULTIHILO (partición estática)...");
+    auto t2 = Clock::now();
+    PrimeStats par = primes_parallel_static(N, num_threads);
+    auto t3 = Clock::now();
+    double ms_par = chrono::duration_cast<ms>(t3 - t2).count();
+
+    cout << "\n[MULTIHILO]\n";
+    cout << "Cantidad de primos < N: " << par.count << "\n";
+    print_top10(par.top10_desc);
+    cout << fixed << setprecision(3)
+         << "Tiempo multihilo: " << ms_par/1000.0 << " s (" << ms_par << " ms)\n";
+
+    if (seq.count != par.count) {
+        cout << "ADVERTENCIA: difiere la cantidad (seq=" << seq.count
+             << ", par=" << par.count << ")\n";
+    }
+    if (ms_par > 0.0) {
+        double speedup = ms_seq / ms_par;
+        cout << "Speedup = " << speedup << "x\n";
+    }
+
+    return 0;
+}
@@ -31,56 +31,159 @@ static vector<int> sieve_base(long long limit) {
     return primes;
 }
 
-// ----------------- SECUENCIAL -----------------
-static PrimeStats primes_sequential(long long N) {
-    vector<uint8_t> is_prime((size_t)N, 1);
-    if (N > 0) is_prime[0] = 0;
-    if (N > 1) is_prime[1] = 0;
+// ----------------- RUEDA 30 EMPAQUETADA EN BITS -----------------
+// Sólo se guardan los candidatos coprimos con 2·3·5: el byte b representa
+// [30b, 30b+30) y su bit k al número 30b + kWheel[k]. Son 8 candidatos por byte,
+// así que un segmento de B bytes cubre 30·B números (contra B con un byte por
+// número). 2, 3 y 5 se agregan aparte.
+//
+// Para tachar los múltiplos de p (>= 7) se recorren sus 8 clases: p·q con
+// q ≡ kWheel[j] (mod 30) cae siempre en el mismo bit, y q -> q+30 avanza
+// exactamente p bytes. Cada clase es un recorrido con paso p y máscara fija.
+static const int kWheel[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+static const array<int8_t, 30> kWheelBit = [] {
+    array<int8_t, 30> b{};
+    b.fill(-1);
+    for (int k = 0; k < 8; ++k) b[kWheel[k]] = (int8_t)k;
+    return b;
+}();
 
-    for (long long p = 2; p * p < N; ++p) {
-        if (is_prime[(size_t)p]) {
-            for (long long j = p * p; j < N; j += p) is_prime[(size_t)j] = 0;
+// Bytes de rueda necesarios para cubrir [0, N)
+static inline long long wheel_bytes(long long N) { return N > 0 ? (N - 1) / 30 + 1 : 0; }
+
+// Criba los bytes [b0, b1) en seg (bit en 1 = primo); base_primes cubre hasta sqrt(30·b1)
+static void sieve_wheel(long long b0, long long b1, const vector<int>& base_primes, uint8_t* seg) {
+    memset(seg, 0xff, (size_t)(b1 - b0));
+    if (b0 == 0) seg[0] &= (uint8_t)~1u;  // 1 no es primo
+    const long long lo = 30 * b0, hi = 30 * b1;  // [lo, hi)
+    for (int p : base_primes) {
+        if (p < 7) continue;
+        if (1LL * p * p >= hi) break;
+        const long long qmin = max<long long>(p, (lo + p - 1) / p);
+        for (int j = 0; j < 8; ++j) {
+            const long long q = qmin + ((kWheel[j] - qmin % 30) + 30) % 30;
+            const long long v = p * q;
+            const uint8_t mask = (uint8_t)~(1u << kWheelBit[v % 30]);
+            for (long long b = v / 30; b < b1; b += p) seg[b - b0] &= mask;
         }
     }
+}
 
-    PrimeStats st;
-    for (long long i = 2; i < N; ++i) if (is_prime[(size_t)i]) ++st.count;
+// Primos representados en los bytes [b0, b1) de seg que son < limit
+static unsigned long long count_wheel(const uint8_t* seg, long long b0, long long b1, long long limit) {
+    unsigned long long cnt = 0;
+    long long full = min(b1, limit / 30);  // bytes enteramente < limit
+    for (long long b = b0; b < full; ++b) cnt += __builtin_popcount(seg[b - b0]);
+    for (long long b = max(b0, full); b < b1; ++b)
+        for (int k = 0; k < 8; ++k)
+            if (30 * b + kWheel[k] < limit && (seg[b - b0] >> k & 1)) ++cnt;
+    return cnt;
+}
+
+// Hasta `want` primos mayores de los bytes [b0, b1) que son < limit (desc)
+static void tail_wheel(const uint8_t* seg, long long b0, long long b1, long long limit,
+                       vector<long long>& out, size_t want)
+{
+    for (long long b = b1 - 1; b >= b0 && out.size() < want; --b) {
+        if (!seg[b - b0]) continue;
+        for (int k = 7; k >= 0 && out.size() < want; --k)
+            if ((seg[b - b0] >> k & 1) && 30 * b + kWheel[k] < limit) out.push_back(30 * b + kWheel[k]);
+    }
+}
 
-    for (long long i = N - 1; i >= 2 && (int)st.top10_desc.size() < 10; --i) {
-        if (is_prime[(size_t)i]) st.top10_desc.push_back(i);
+// Agrega 2, 3 y 5 (fuera de la rueda) a la cuenta y al top 10
+static void add_wheel_primes(long long N, PrimeStats& st) {
+    for (int p : {5, 3, 2}) {
+        if (p >= N) continue;
+        ++st.count;
+        if (st.top10_desc.size() < 10) st.top10_desc.push_back(p);
     }
+}
+
+// ----------------- SECUENCIAL -----------------
+static PrimeStats primes_sequential(long long N) {
+    const long long nb = wheel_bytes(N);
+    vector<uint8_t> bits((size_t)nb);
+    vector<int> base = sieve_base((long long)sqrt((long double)(30 * nb)) + 1);
+    sieve_wheel(0, nb, base, bits.data());
+
+    PrimeStats st;
+    st.count = count_wheel(bits.data(), 0, nb, N);
+    tail_wheel(bits.data(), 0, nb, N, st.top10_desc, 10);
+    add_wheel_primes(N, st);
     return st;
 }
 
 // ----------------- MULTIHILO: INTERVALOS VARIABLES + COLA DINÁMICA -----------------
+// Los bloques se reparten en bytes de rueda. Cada hilo criba su bloque en
+// segmentos del tamaño de la L1 (un solo buffer por hilo, reutilizado).
+// - Primos chicos (p < segmento): tocan cada segmento varias veces; se guarda el
+//   próximo byte de cada una de sus 8 clases y se continúa de un segmento al siguiente.
+// - Primos grandes (p >= segmento): tocan cada segmento a lo sumo una vez por
+//   clase. Van en cubetas por segmento (Oliveira e Silva), así cada segmento
+//   visita sólo los primos que efectivamente lo tocan.
+// Memoria por hilo: el segmento más una entrada de 8 bytes por (primo grande, clase)
+// pendiente, o sea hasta 64 bytes por primo base grande: ~64·π(√N) bytes, que crece
+// con √N / ln √N: ~5 MB por hilo para N = 1e12, ~370 MB para N = 1e16.
 struct ThreadResult {
     unsigned long long count = 0;
-    vector<long long> tails; // colecciona hasta 10 de cada bloque
+    vector<long long> tails; // 10 mayores vistos por el hilo (desc)
+};
+
+struct SieveConfig {
+    long long seg_bytes = 32 * 1024;  // segmento (bytes de rueda)
+    long long min_chunk = 0, max_chunk = 0;  // bloques por reclamo (bytes, múltiplos de seg_bytes)
 };
 
+// Tope de un bloque de SegmentSiever: las cubetas guardan offsets de 32 bits
+// relativos al inicio del bloque
+static const long long kMaxChunkBytes = 1LL << 30;
+
+static long long l1d_bytes() {
+    long v = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    return v > 0 ? v : 32 * 1024;
+}
+
+// Bloques lo bastante grandes para amortizar la inicialización de las cubetas
+// (8·pi(sqrt N) entradas por bloque), pero con >= 4-8 bloques por hilo.
+static SieveConfig sieve_config(long long N, int num_threads, long long seg_bytes) {
+    SieveConfig c;
+    c.seg_bytes = max(1024LL, seg_bytes);
+    const long long nb = wheel_bytes(N), seg = c.seg_bytes;
+    auto round_seg = [&](long long x) { return max(seg, (x + seg - 1) / seg * seg); };
+    c.min_chunk = round_seg(max(16 * seg, 8 * (long long)sqrt((long double)N)));
+    c.min_chunk = min(c.min_chunk, round_seg(nb / (8LL * num_threads)));
+    c.max_chunk = max(c.min_chunk, min(4 * c.min_chunk, round_seg(nb / (4LL * num_threads))));
+    const long long cap = max(seg, kMaxChunkBytes / seg * seg);
+    c.min_chunk = min(c.min_chunk, cap);
+    c.max_chunk = min(c.max_chunk, cap);
+    return c;
+}
+
 // Tamaño de bloque “creciente” con la posición (no constante).
-static inline long long tile_len_for(long long lo, long long end, long long total) {
+static inline long long tile_len_for(long long lo, long long end, long long total, const SieveConfig& cfg) {
     // f ∈ [0,1]: progreso del rango
-    double f = (total > 0) ? double(lo - 2) / double(total) : 0.0;
-    // Límites de tamaño de bloque (en cantidad de números)
-    const long long MIN_TILE = 1LL << 18; // 262,144
-    const long long MAX_TILE = 1LL << 21; // 2,097,152
+    double f = (total > 0) ? double(lo) / double(total) : 0.0;
+    // Límites de tamaño de bloque (en bytes de rueda)
+    const long long MIN_TILE = cfg.min_chunk;
+    const long long MAX_TILE = cfg.max_chunk;
     long long len = (long long)(MIN_TILE + (MAX_TILE - MIN_TILE) * f);
     if (len < MIN_TILE) len = MIN_TILE;
     if (len > MAX_TILE) len = MAX_TILE;
+    len = (len + cfg.seg_bytes - 1) / cfg.seg_bytes * cfg.seg_bytes;  // segmentos enteros
     // Ajuste si nos pasamos del final
     if (lo + len - 1 > end) len = end - lo + 1;
     return max(0LL, len);
 }
 
 static bool claim_next_chunk(atomic<long long>& cursor, long long end, long long total,
-                             long long& lo, long long& hi)
+                             const SieveConfig& cfg, long long& lo, long long& hi)
 {
     while (true) {
         long long cur = cursor.load(memory_order_relaxed);
         if (cur > end) return false;
 
-        long long len = tile_len_for(cur, end, total);
+        long long len = tile_len_for(cur, end, total, cfg);
         if (len <= 0) return false;
 
         long long next = cur + len;
@@ -93,68 +196,358 @@ static bool claim_next_chunk(atomic<long long>& cursor, long long end, long long
     }
 }
 
-static void sieve_segment(long long lo, long long hi,
-                          const vector<int>& base_primes,
-                          unsigned long long& count_out,
-                          vector<long long>& tail_out)
-{
-    const size_t L = (size_t)(hi - lo + 1);
-    vector<uint8_t> seg(L, 1);
-    if (lo == 0) seg[0] = 0;
-    if (lo <= 1 && 1 <= hi) seg[(size_t)(1 - lo)] = 0;
+// Estado de criba de un hilo: buffer de segmento, próximos múltiplos de los
+// primos chicos y cubetas de los grandes. Se reutiliza entre bloques.
+class SegmentSiever {
+public:
+    SegmentSiever(const vector<int>& base, long long seg_bytes) : base(base), seg(seg_bytes), buf((size_t)seg_bytes) {
+        first = 0;
+        while (first < base.size() && base[first] < 7) ++first;
+        split = first;
+        while (split < base.size() && base[split] < seg) ++split;
+        next_small.resize((split - first) * 8);
+        mask_small.resize((split - first) * 8);
+        const long long max_p = base.empty() ? 1 : base.back();
+        buckets.resize((size_t)((max_p + seg - 1) / seg + 1));
+    }
 
-    for (int p : base_primes) {
-        long long pp = 1LL * p * p;
-        if (pp > hi) break;
-        long long start = max(pp, ((lo + p - 1) / (long long)p) * (long long)p);
-        for (long long j = start; j <= hi; j += p) seg[(size_t)(j - lo)] = 0;
+    // Prepara el bloque de bytes [b0, b1); b0 es múltiplo del segmento y
+    // b1 - b0 <= kMaxChunkBytes
+    void begin_chunk(long long b0, long long b1) {
+        chunk0 = b0;
+        chunk1 = b1;
+        for (auto& b : buckets) b.clear();
+        const long long lo = 30 * b0, hi = 30 * b1;
+        for (size_t i = first; i < base.size(); ++i) {
+            const long long p = base[i];
+            if (p * p >= hi) {
+                if (i < split) fill_n(next_small.begin() + (i - first) * 8, 8, b1);
+                continue;
+            }
+            const long long qmin = max(p, (lo + p - 1) / p);
+            for (int j = 0; j < 8; ++j) {
+                const long long q = qmin + ((kWheel[j] - qmin % 30) + 30) % 30;
+                const long long v = p * q;
+                const int bit = kWheelBit[v % 30];
+                if (i < split) {
+                    next_small[(i - first) * 8 + j] = v / 30;
+                    mask_small[(i - first) * 8 + j] = (uint8_t)~(1u << bit);
+                } else if (v / 30 < b1) {
+                    push(v / 30, (uint32_t)((i << 3) | bit));
+                }
+            }
+        }
     }
 
-    unsigned long long cnt = 0;
-    for (size_t i = 0; i < L; ++i) if (seg[i]) ++cnt;
-    count_out = cnt;
+    // Criba el segmento [sb0, sb1) del bloque actual en buf
+    const uint8_t* sieve(long long sb0, long long sb1) {
+        uint8_t* s = buf.data();
+        memset(s, 0xff, (size_t)(sb1 - sb0));
+        if (sb0 == 0) s[0] &= (uint8_t)~1u;  // 1 no es primo
+
+        for (size_t k = 0; k < next_small.size(); ++k) {
+            const long long p = base[first + k / 8];
+            const uint8_t mask = mask_small[k];
+            long long b = next_small[k];
+            for (; b < sb1; b += p) s[b - sb0] &= mask;
+            next_small[k] = b;
+        }
+
+        // La cubeta se vacía en scratch: lo que se re-encola puede caer en la misma
+        // (entradas que arrancan en p² muchos segmentos más adelante)
+        scratch.clear();
+        scratch.swap(buckets[(size_t)((sb0 / seg) % (long long)buckets.size())]);
+        for (const Bucket& e : scratch) {
+            const long long b = chunk0 + e.offset;
+            if (b >= sb1) {
+                push(b, e.prime_bit);
+                continue;
+            }
+            s[b - sb0] &= (uint8_t)~(1u << (e.prime_bit & 7));
+            const long long nb = b + base[e.prime_bit >> 3];
+            if (nb < chunk1) push(nb, e.prime_bit);
+        }
+        return s;
+    }
 
-    // Guardar hasta 10 mayores del bloque
-    for (long long j = hi; j >= lo && (int)tail_out.size() < 10; --j) {
-        if (seg[(size_t)(j - lo)]) tail_out.push_back(j);
+private:
+    struct Bucket {
+        uint32_t offset;     // byte relativo al inicio del bloque
+        uint32_t prime_bit;  // (índice del primo << 3) | bit
+    };
+    void push(long long byte, uint32_t prime_bit) {
+        buckets[(size_t)((byte / seg) % (long long)buckets.size())].push_back({(uint32_t)(byte - chunk0), prime_bit});
+    }
+
+    const vector<int>& base;
+    long long seg;
+    size_t first = 0, split = 0;  // base[first, split): chicos; base[split, ...): grandes
+    vector<long long> next_small;
+    vector<uint8_t> mask_small;
+    vector<vector<Bucket>> buckets;
+    vector<Bucket> scratch;
+    vector<uint8_t> buf;
+    long long chunk0 = 0, chunk1 = 0;
+};
+
+// ----------------- POLÍTICAS DE PLANIFICACIÓN -----------------
+// Todas reparten bloques de bytes de rueda [lo, hi] alineados al segmento:
+//   estatico : un bloque contiguo por hilo (T partes iguales)
+//   ciclico  : bloques de tamaño fijo, el hilo t toma t, t+T, t+2T, ...
+//   guiado   : cursor compartido, cada bloque = restante / (2T) (con mínimo)
+//   creciente: cursor compartido con bloques que crecen con la posición (CAS)
+//   robo     : colas por hilo con su franja estática; al vaciarse roba del
+//              final de las colas ajenas
+enum class SchedPolicy { StaticBlock, StaticCyclic, Guided, Growing, Stealing };
+
+static const char* policy_name(SchedPolicy p) {
+    switch (p) {
+        case SchedPolicy::StaticBlock:  return "estatico";
+        case SchedPolicy::StaticCyclic: return "ciclico";
+        case SchedPolicy::Guided:       return "guiado";
+        case SchedPolicy::Growing:      return "creciente";
+        case SchedPolicy::Stealing:     return "robo";
     }
+    return "?";
 }
 
-static PrimeStats primes_parallel_var(long long N, int num_threads) {
+static bool parse_policy(const string& s, SchedPolicy& p) {
+    for (SchedPolicy c : {SchedPolicy::StaticBlock, SchedPolicy::StaticCyclic, SchedPolicy::Guided,
+                          SchedPolicy::Growing, SchedPolicy::Stealing})
+        if (s == policy_name(c)) { p = c; return true; }
+    return false;
+}
+
+struct Chunk { long long lo, hi; };
+
+class ChunkScheduler {
+public:
+    virtual ~ChunkScheduler() = default;
+    // Próximo bloque para el hilo tid; stolen indica si vino de otra cola
+    virtual bool next(int tid, Chunk& out, bool& stolen) = 0;
+};
+
+// Frontera k de T partes de [0, total), redondeada al segmento
+static inline long long seg_boundary(long long total, int T, int k, long long seg) {
+    if (k >= T) return total;
+    return (long long)((long double)total * k / T) / seg * seg;
+}
+
+class StaticBlockScheduler : public ChunkScheduler {
+public:
+    StaticBlockScheduler(long long total, int T, const SieveConfig& cfg) : total(total), T(T), cfg(cfg), done(T, 0) {}
+    bool next(int tid, Chunk& out, bool& stolen) override {
+        stolen = false;
+        if (done[tid]) return false;
+        done[tid] = 1;
+        out = {seg_boundary(total, T, tid, cfg.seg_bytes), seg_boundary(total, T, tid + 1, cfg.seg_bytes) - 1};
+        return out.lo <= out.hi;
+    }
+private:
+    long long total;
+    int T;
+    SieveConfig cfg;
+    vector<char> done;  // cada hilo sólo toca su entrada
+};
+
+class StaticCyclicScheduler : public ChunkScheduler {
+public:
+    StaticCyclicScheduler(long long total, int T, const SieveConfig& cfg) : total(total), T(T), len(cfg.min_chunk), k(T, 0) {}
+    bool next(int tid, Chunk& out, bool& stolen) override {
+        stolen = false;
+        const long long lo = (tid + k[tid]++ * (long long)T) * len;
+        if (lo >= total) return false;
+        out = {lo, min(total, lo + len) - 1};
+        return true;
+    }
+private:
+    long long total;
+    int T;
+    long long len;
+    vector<long long> k;
+};
+
+class GuidedScheduler : public ChunkScheduler {
+public:
+    GuidedScheduler(long long total, int T, const SieveConfig& cfg) : total(total), T(T), cfg(cfg), cursor(0) {}
+    bool next(int, Chunk& out, bool& stolen) override {
+        stolen = false;
+        long long cur = cursor.load(memory_order_relaxed);
+        while (cur < total) {
+            long long len = max(cfg.min_chunk, (total - cur) / (2LL * T));
+            len = (len + cfg.seg_bytes - 1) / cfg.seg_bytes * cfg.seg_bytes;
+            const long long nxt = min(total, cur + len);
+            if (cursor.compare_exchange_weak(cur, nxt, memory_order_acq_rel, memory_order_relaxed)) {
+                out = {cur, nxt - 1};
+                return true;
+            }
+        }
+        return false;
+    }
+private:
+    long long total;
+    int T;
+    SieveConfig cfg;
+    atomic<long long> cursor;
+};
+
+class GrowingScheduler : public ChunkScheduler {
+public:
+    GrowingScheduler(long long total, const SieveConfig& cfg) : total(total), cfg(cfg), cursor(0) {}
+    bool next(int, Chunk& out, bool& stolen) override {
+        stolen = false;
+        return claim_next_chunk(cursor, total - 1, total, cfg, out.lo, out.hi);
+    }
+private:
+    long long total;
+    SieveConfig cfg;
+    atomic<long long> cursor;
+};
+
+class StealingScheduler : public ChunkScheduler {
+public:
+    StealingScheduler(long long total, int T, const SieveConfig& cfg) : T(T), queues(new Queue[T]) {
+        for (int t = 0; t < T; ++t) {
+            const long long b0 = seg_boundary(total, T, t, cfg.seg_bytes), b1 = seg_boundary(total, T, t + 1, cfg.seg_bytes);
+            for (long long lo = b0; lo < b1; lo += cfg.min_chunk) queues[t].q.push_back({lo, min(b1, lo + cfg.min_chunk) - 1});
+        }
+    }
+    // Primero la cola propia (por delante), luego roba (por detrás) de las demás
+    bool next(int tid, Chunk& out, bool& stolen) override {
+        {
+            lock_guard<mutex> lk(queues[tid].mtx);
+            if (!queues[tid].q.empty()) {
+                out = queues[tid].q.front();
+                queues[tid].q.pop_front();
+                stolen = false;
+                return true;
+            }
+        }
+        for (int d = 1; d < T; ++d) {
+            Queue& v = queues[(tid + d) % T];
+            lock_guard<mutex> lk(v.mtx);
+            if (!v.q.empty()) {
+                out = v.q.back();
+                v.q.pop_back();
+                stolen = true;
+                return true;
+            }
+        }
+        return false;
+    }
+private:
+    struct alignas(64) Queue {
+        mutex mtx;
+        deque<Chunk> q;
+    };
+    int T;
+    unique_ptr<Queue[]> queues;
+};
+
+static unique_ptr<ChunkScheduler> make_scheduler(SchedPolicy p, long long total, int T, const SieveConfig& cfg) {
+    switch (p) {
+        case SchedPolicy::StaticBlock:  return make_unique<StaticBlockScheduler>(total, T, cfg);
+        case SchedPolicy::StaticCyclic: return make_unique<StaticCyclicScheduler>(total, T, cfg);
+        case SchedPolicy::Guided:       return make_unique<GuidedScheduler>(total, T, cfg);
+        case SchedPolicy::Growing:      return make_unique<GrowingScheduler>(total, cfg);
+        case SchedPolicy::Stealing:     return make_unique<StealingScheduler>(total, T, cfg);
+    }
+    return nullptr;
+}
+
+// Tiempos por hilo de la última corrida paralela
+struct ThreadTiming {
+    long chunks = 0, steals = 0;
+    double busy_ms = 0, idle_ms = 0;  // cribando / resto del tiempo total
+};
+struct SchedStats {
+    SchedPolicy policy = SchedPolicy::Growing;
+    double wall_ms = 0;
+    vector<ThreadTiming> threads;
+};
+static SchedStats g_sched_stats;
+
+static void print_sched_stats(const SchedStats& s) {
+    cout << "Planificador " << policy_name(s.policy) << ":\n";
+    cout << "  hilo  bloques  robados   ocupado (ms)   ocioso (ms)\n";
+    double busy = 0, max_busy = 0;
+    for (size_t t = 0; t < s.threads.size(); ++t) {
+        const ThreadTiming& h = s.threads[t];
+        busy += h.busy_ms;
+        max_busy = max(max_busy, h.busy_ms);
+        cout << setw(6) << t << setw(9) << h.chunks << setw(9) << h.steals << setw(15) << h.busy_ms << setw(14)
+             << h.idle_ms << "\n";
+    }
+    const double mean = s.threads.empty() ? 0 : busy / s.threads.size();
+    cout << "  desbalance (máx/promedio ocupado) = " << (mean > 0 ? max_busy / mean : 0.0)
+         << "   eficiencia = " << (s.wall_ms > 0 ? 100.0 * busy / (s.wall_ms * s.threads.size()) : 0.0) << "%\n";
+}
+
+// Mantiene en top los `want` mayores (desc) al sumar los de v (desc)
+static void merge_top(vector<long long>& top, const vector<long long>& v, size_t want) {
+    vector<long long> out;
+    merge(top.begin(), top.end(), v.begin(), v.end(), back_inserter(out), greater<long long>());
+    if (out.size() > want) out.resize(want);
+    top.swap(out);
+}
+
+static PrimeStats primes_parallel_var(long long N, int num_threads, long long seg_bytes,
+                                      SchedPolicy policy = SchedPolicy::Growing) {
     num_threads = max(1, num_threads);
 
-    // Primos base (<= sqrt(N))
-    vector<int> base = sieve_base((long long)floor(sqrt((long double)N)));
+    // Primos base (<= sqrt(N), redondeado al byte de rueda final)
+    vector<int> base = sieve_base((long long)sqrt((long double)(30 * wheel_bytes(N))) + 1);
+    const SieveConfig cfg = sieve_config(N, num_threads, seg_bytes);
 
-    // Rango global [2, N-1]
-    const long long BEGIN = 2;
-    const long long END   = N - 1;
-    const long long TOTAL = max(0LL, END - BEGIN + 1);
+    // Rango global en bytes de rueda: [0, wheel_bytes(N))
+    const long long TOTAL = wheel_bytes(N);
+    unique_ptr<ChunkScheduler> sched = make_scheduler(policy, TOTAL, num_threads, cfg);
 
-    atomic<long long> cursor(BEGIN);
     vector<thread> ths;
     vector<ThreadResult> accum(num_threads);
+    vector<ThreadTiming> timing(num_threads);
+    const auto t_start = Clock::now();
 
     auto worker = [&](int tid) {
         unsigned long long local_count = 0;
-        vector<long long> local_tails; local_tails.reserve(200);
+        vector<long long> local_top, tail;
+        SegmentSiever siever(base, cfg.seg_bytes);
+        ThreadTiming& tm = timing[tid];
 
-        long long lo, hi;
-        while (claim_next_chunk(cursor, END, TOTAL, lo, hi)) {
-            unsigned long long c = 0;
-            vector<long long> tail;
-            sieve_segment(lo, hi, base, c, tail);
-            local_count += c;
-            // concatenar tails del bloque
-            local_tails.insert(local_tails.end(), tail.begin(), tail.end());
+        Chunk c;
+        bool stolen;
+        while (sched->next(tid, c, stolen)) {
+            auto tb = Clock::now();
+            // estatico y guiado pueden entregar bloques mayores que kMaxChunkBytes
+            const long long piece = kMaxChunkBytes / cfg.seg_bytes * cfg.seg_bytes;
+            for (long long p0 = c.lo; p0 <= c.hi; p0 += piece) {
+                const long long p1 = min(c.hi + 1, p0 + piece);
+                siever.begin_chunk(p0, p1);
+                for (long long sb0 = p0; sb0 < p1; sb0 += cfg.seg_bytes) {
+                    const long long sb1 = min(p1, sb0 + cfg.seg_bytes);
+                    const uint8_t* s = siever.sieve(sb0, sb1);
+                    local_count += count_wheel(s, sb0, sb1, N);
+                    tail.clear();
+                    tail_wheel(s, sb0, sb1, N, tail, 10);
+                    merge_top(local_top, tail, 10);
+                }
+            }
+            tm.busy_ms += chrono::duration_cast<ms>(Clock::now() - tb).count();
+            ++tm.chunks;
+            tm.steals += stolen;
         }
         accum[tid].count = local_count;
-        accum[tid].tails = move(local_tails);
+        accum[tid].tails = move(local_top);
     };
 
     for (int t = 0; t < num_threads; ++t) ths.emplace_back(worker, t);
     for (auto& h : ths) h.join();
 
+    g_sched_stats.policy = policy;
+    g_sched_stats.wall_ms = chrono::duration_cast<ms>(Clock::now() - t_start).count();
+    for (auto& tm : timing) tm.idle_ms = max(0.0, g_sched_stats.wall_ms - tm.busy_ms);
+    g_sched_stats.threads = timing;
+
     PrimeStats st;
     for (auto& r : accum) st.count += r.count;
 
@@ -162,10 +555,386 @@ static PrimeStats primes_parallel_var(long long N, int num_threads) {
     for (auto& r : accum) all.insert(all.end(), r.tails.begin(), r.tails.end());
     sort(all.begin(), all.end(), greater<long long>());
     for (size_t i = 0; i < all.size() && i < 10; ++i) st.top10_desc.push_back(all[i]);
+    add_wheel_primes(N, st);
+
+    return st;
+}
+
+// ----------------- CONTEO pi(N) SIN CRIBAR HASTA N (Lucy_Hedgehog) -----------------
+// S(v) = cantidad de primos <= v, sólo para los O(sqrt N) valores v = floor(N/i).
+// Se parte de S(v) = v - 1 y, por cada primo p <= sqrt(N), para todo v >= p²:
+//   S(v) -= S(v/p) - S(p-1)
+// Costo O(N^(3/4)) tiempo y O(sqrt N) memoria. Los v <= r = sqrt(N) se indexan
+// por v (chicos) y los v = N/i por i (grandes).
+// En paralelo, cada paso (un primo p) se hace en dos pasadas repartidas entre
+// los hilos: primero se calculan todas las restas leyendo los valores viejos y
+// después se aplican, con una barrera entre pasadas. Cuando el paso ya tiene
+// poco trabajo (N/p² chico), sigue un solo hilo hasta el final.
+class StepBarrier {
+public:
+    explicit StepBarrier(int n) : n(n) {}
+    void wait() {
+        unique_lock<mutex> lk(mtx);
+        const long gen = generation;
+        if (++arrived == n) {
+            arrived = 0;
+            ++generation;
+            cv.notify_all();
+        } else {
+            cv.wait(lk, [&] { return generation != gen; });
+        }
+    }
+private:
+    mutex mtx;
+    condition_variable cv;
+    int n, arrived = 0;
+    long generation = 0;
+};
+
+// floor(n / d) con división en double y corrección de ±1 (n < 2^63, d >= 1);
+// bastante más barata que la división entera de 64 bits en el lazo interno.
+static inline long long fast_div(long long n, long long d) {
+    long long q = (long long)((double)n / (double)d);
+    if (q * d > n) --q;
+    else if ((q + 1) * d <= n) ++q;
+    return q;
+}
+
+// Cantidad de primos <= n
+static unsigned long long prime_pi(long long n, int num_threads) {
+    if (n < 2) return 0;
+    const long long r = (long long)sqrtl((long double)n);
+    // small[v] = S(v), v in [0, r]; large[i] = S(n / i), i in [1, r]
+    vector<long long> small(r + 1), large(r + 1), delta;
+    for (long long v = 0; v <= r; ++v) small[v] = v - 1;
+    for (long long i = 1; i <= r; ++i) large[i] = n / i - 1;
+    small[0] = 0;
+
+    num_threads = max(1, num_threads);
+    const long long PAR_MIN = 1LL << 14;  // trabajo mínimo por paso para repartirlo
+    if (num_threads > 1) delta.resize(r + 1);
+    StepBarrier barrier(num_threads);
 
+    auto worker = [&](int tid) {
+        vector<long long> sdelta;
+        for (long long p = 2; p <= r; ++p) {
+            if (small[p] == small[p - 1]) continue;  // p no es primo
+            const long long sp = small[p - 1], p2 = p * p;
+            const long long lmax = min(r, n / p2);      // grandes afectados: i <= lmax
+            const long long smin = p2;                   // chicos afectados: v >= p²
+            const long long nsmall = max(0LL, r - smin + 1);
+            const bool par = lmax + nsmall >= PAR_MIN && num_threads > 1;
+            if (!par) {
+                if (tid != 0) return;  // el resto lo termina el hilo 0
+                // En un solo hilo se actualiza en el lugar: los grandes en i
+                // creciente leen i·p > i y los chicos en v decreciente leen
+                // v/p < v, así que todavía tienen el valor viejo.
+                for (long long i = 1; i <= lmax; ++i) {
+                    const long long ip = i * p;
+                    large[i] -= (ip <= r ? large[ip] : small[fast_div(n, ip)]) - sp;
+                }
+                for (long long v = r; v >= smin; --v) small[v] -= small[v / p] - sp;
+                continue;
+            }
+
+            // Pasada 1: restas con valores viejos
+            const int T = num_threads;
+            const long long i0 = 1 + lmax * tid / T, i1 = lmax * (tid + 1) / T;
+            const long long s0 = smin + nsmall * tid / T, s1 = smin + nsmall * (tid + 1) / T;
+            for (long long i = i0; i <= i1; ++i) {
+                const long long ip = i * p;
+                delta[i] = (ip <= r ? large[ip] : small[fast_div(n, ip)]) - sp;
+            }
+            sdelta.resize((size_t)max(0LL, s1 - s0));
+            for (long long v = s0; v < s1; ++v) sdelta[(size_t)(v - s0)] = small[v / p] - sp;
+            barrier.wait();
+            // Pasada 2: aplicar
+            for (long long i = i0; i <= i1; ++i) large[i] -= delta[i];
+            for (long long v = s0; v < s1; ++v) small[v] -= sdelta[(size_t)(v - s0)];
+            barrier.wait();
+        }
+    };
+
+    vector<thread> ths;
+    for (int t = 1; t < num_threads; ++t) ths.emplace_back(worker, t);
+    worker(0);
+    for (auto& h : ths) h.join();
+    return (unsigned long long)large[1];
+}
+
+// Los 10 mayores primos < N: criba una ventana [N - W, N) que se duplica hasta
+// tener 10 (o llegar a 2). W arranca en ~40·ln N (diez huecos promedio de sobra).
+static vector<long long> top10_below(long long N) {
+    vector<long long> out;
+    if (N <= 2) return out;
+    vector<int> base = sieve_base((long long)sqrtl((long double)(N - 1)) + 1);
+    long long W = max(1024LL, (long long)(40 * log((double)N)));
+    while (true) {
+        const long long lo = max(2LL, N - W), hi = N - 1;
+        vector<uint8_t> seg((size_t)(hi - lo + 1), 1);
+        for (int p : base) {
+            const long long pp = 1LL * p * p;
+            if (pp > hi) break;
+            long long start = max(pp, (lo + p - 1) / p * (long long)p);
+            for (long long j = start; j <= hi; j += p) seg[(size_t)(j - lo)] = 0;
+        }
+        out.clear();
+        for (long long j = hi; j >= lo && out.size() < 10; --j)
+            if (seg[(size_t)(j - lo)]) out.push_back(j);
+        if (out.size() >= 10 || lo == 2) return out;
+        W *= 2;
+    }
+}
+
+static PrimeStats primes_count_lucy(long long N, int num_threads) {
+    PrimeStats st;
+    st.count = prime_pi(N - 1, num_threads);
+    st.top10_desc = top10_below(N);
     return st;
 }
 
+// ----------------- CONSULTAS POR INTERVALO [lo, hi] -----------------
+// Cuesta según el ancho W = hi - lo + 1, no según hi. Dos métodos:
+// - criba: se criba sólo la ventana, en bits de rueda. Los primos base
+//   <= S = min(sqrt hi, 2^22) van por SegmentSiever en la parte de cada hilo.
+//   Los base en (S, sqrt hi] no se guardan: se generan por segmentos y cada uno
+//   tacha sus pocos múltiplos en la ventana. Costo ~ W + sqrt(hi).
+// - mr: Miller-Rabin determinístico de 64 bits sobre los candidatos de la rueda
+//   (con división de prueba previa). Costo ~ W, sin depender de sqrt(hi).
+// "auto" elige mr cuando la ventana es muy angosta frente a sqrt(hi).
+static inline uint64_t mulmod64(uint64_t a, uint64_t b, uint64_t m) {
+    return (uint64_t)((unsigned __int128)a * b % m);
+}
+
+static uint64_t powmod64(uint64_t b, uint64_t e, uint64_t m) {
+    uint64_t r = 1;
+    b %= m;
+    for (; e; e >>= 1) {
+        if (e & 1) r = mulmod64(r, b, m);
+        b = mulmod64(b, b, m);
+    }
+    return r;
+}
+
+// Determinístico para todo n < 2^64 (bases de Jim Sinclair)
+static bool is_prime_u64(uint64_t n) {
+    if (n < 2) return false;
+    static const uint32_t small_primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71};
+    for (uint32_t p : small_primes) {
+        if (n == p) return true;
+        if (n % p == 0) return false;
+    }
+    if (n < 73 * 73) return true;
+    uint64_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    for (uint64_t a : {2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL}) {
+        a %= n;
+        if (a == 0) continue;
+        uint64_t x = powmod64(a, d, n);
+        if (x == 1 || x == n - 1) continue;
+        bool composite = true;
+        for (int r = 1; r < s && composite; ++r) {
+            x = mulmod64(x, x, n);
+            if (x == n - 1) composite = false;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+struct RangeResult {
+    unsigned long long count = 0;
+    vector<long long> bottom, top;  // K menores (asc) y K mayores (desc)
+    vector<long long> list;         // todos (asc), si se pidió
+    string method;
+};
+
+enum class RangeMethod { Auto, Sieve, MillerRabin };
+
+// Recorre los primos de la ventana de bits [b0, b1) dentro de [lo, hi], en orden
+template <class Fn>
+static void for_each_wheel_prime(const uint8_t* seg, long long b0, long long b1, long long lo, long long hi, Fn fn) {
+    for (long long b = b0; b < b1; ++b) {
+        uint8_t bits = seg[b - b0];
+        while (bits) {
+            const int k = __builtin_ctz(bits);
+            bits &= bits - 1;
+            const long long v = 30 * b + kWheel[k];
+            if (v >= lo && v <= hi) fn(v);
+        }
+    }
+}
+
+static RangeResult range_sieve(long long lo, long long hi, size_t K, bool want_list, int num_threads,
+                               long long seg_bytes) {
+    const long long b0 = lo / 30, b1 = hi / 30 + 1, nbytes = b1 - b0;
+    const long long root = (long long)sqrtl((long double)hi);
+    const long long S = min(root, 1LL << 22);
+    vector<uint8_t> win((size_t)nbytes);
+    const vector<int> small_base = sieve_base(S);
+    const long long seg = max(1024LL, seg_bytes);
+    num_threads = max(1, (int)min<long long>(num_threads, nbytes));
+
+    // Fase A: cada hilo criba su parte con los primos base chicos (segmentos de L1
+    // con cubetas). Los bloques arrancan alineados al segmento, antes de b0 si hace falta
+    {
+        vector<thread> ths;
+        for (int t = 0; t < num_threads; ++t)
+            ths.emplace_back([&, t] {
+                const long long pb0 = b0 + nbytes * t / num_threads, pb1 = b0 + nbytes * (t + 1) / num_threads;
+                if (pb1 <= pb0) return;
+                SegmentSiever siever(small_base, seg);
+                const long long CHUNK = kMaxChunkBytes / seg * seg;
+                for (long long c0 = pb0 - pb0 % seg; c0 < pb1; c0 += CHUNK) {
+                    const long long c1 = min(pb1, c0 + CHUNK);
+                    siever.begin_chunk(c0, c1);
+                    for (long long sb0 = c0; sb0 < c1; sb0 += seg) {
+                        const long long sb1 = min(c1, sb0 + seg);
+                        const uint8_t* sv = siever.sieve(sb0, sb1);
+                        const long long from = max(sb0, pb0);
+                        memcpy(win.data() + (from - b0), sv + (from - sb0), (size_t)(sb1 - from));
+                    }
+                }
+            });
+        for (auto& h : ths) h.join();
+    }
+
+    // Fase B: primos base en (S, root], generados por segmentos repartidos entre
+    // hilos. Cada p tacha sólo p·q con q coprimo con 30 (q avanza por la rueda);
+    // con más de un hilo el AND es atómico porque los bytes se comparten
+    if (root > S) {
+        static const int kGap[8] = {6, 4, 2, 4, 2, 4, 6, 2};  // kWheel[j+1] - kWheel[j] (mod 30)
+        const vector<int> tiny = sieve_base((long long)sqrtl((long double)root) + 1);
+        const long long span = root - S, SEG = 1LL << 18;
+        const bool shared = num_threads > 1;
+        atomic<long long> next_seg(0);
+        vector<thread> ths;
+        for (int t = 0; t < num_threads; ++t)
+            ths.emplace_back([&] {
+                vector<uint8_t> is_p((size_t)SEG);
+                for (long long k; (k = next_seg.fetch_add(1)) * SEG < span;) {
+                    const long long s_lo = S + 1 + k * SEG, s_hi = min(root, s_lo + SEG - 1);
+                    fill(is_p.begin(), is_p.end(), 1);
+                    for (int q : tiny) {
+                        const long long qq = 1LL * q * q;
+                        if (qq > s_hi) break;
+                        for (long long j = max(qq, (s_lo + q - 1) / q * (long long)q); j <= s_hi; j += q) is_p[j - s_lo] = 0;
+                    }
+                    for (long long p = s_lo | 1; p <= s_hi; p += 2) {
+                        if (!is_p[p - s_lo]) continue;
+                        long long q = max(p, (lo + p - 1) / p);
+                        const int r = (int)(q % 30);
+                        int j = 0;
+                        while (j < 8 && kWheel[j] < r) ++j;
+                        q += j < 8 ? kWheel[j] - r : 31 - r;
+                        j &= 7;
+                        const int pr = (int)(p % 30);
+                        for (long long m = p * q; m <= hi; m += p * kGap[j], j = (j + 1) & 7) {
+                            const uint8_t mask = (uint8_t)~(1u << kWheelBit[pr * kWheel[j] % 30]);
+                            uint8_t& byte = win[(size_t)(m / 30 - b0)];
+                            if (shared) __atomic_fetch_and(&byte, mask, __ATOMIC_RELAXED);
+                            else byte &= mask;
+                        }
+                    }
+                }
+            });
+        for (auto& h : ths) h.join();
+    }
+
+    RangeResult res;
+    res.method = "criba";
+    for (int p : {2, 3, 5})
+        if (p >= lo && p <= hi) {
+            ++res.count;
+            if (res.bottom.size() < K) res.bottom.push_back(p);
+            if (want_list) res.list.push_back(p);
+        }
+    for_each_wheel_prime(win.data(), b0, b1, lo, hi, [&](long long v) {
+        ++res.count;
+        if (res.bottom.size() < K) res.bottom.push_back(v);
+        if (want_list) res.list.push_back(v);
+    });
+    // Top K: desde el final de la ventana
+    for (long long b = b1 - 1; b >= b0 && res.top.size() < K; --b) {
+        const uint8_t bits = win[b - b0];
+        for (int k = 7; k >= 0 && res.top.size() < K; --k) {
+            const long long v = 30 * b + kWheel[k];
+            if ((bits >> k & 1) && v >= lo && v <= hi) res.top.push_back(v);
+        }
+    }
+    for (int p : {5, 3, 2})
+        if (p >= lo && p <= hi && res.top.size() < K) res.top.push_back(p);
+    return res;
+}
+
+static RangeResult range_miller_rabin(long long lo, long long hi, size_t K, bool want_list, int num_threads) {
+    const long long W = hi - lo + 1;
+    num_threads = max(1, (int)min<long long>(num_threads, W));
+    struct Part { unsigned long long count = 0; vector<long long> bottom, top, list; };
+    vector<Part> parts(num_threads);
+    vector<thread> ths;
+    for (int t = 0; t < num_threads; ++t)
+        ths.emplace_back([&, t] {
+            Part& pt = parts[t];
+            const long long p_lo = lo + (long long)((__int128)W * t / num_threads);
+            const long long p_hi = lo + (long long)((__int128)W * (t + 1) / num_threads) - 1;
+            deque<long long> last;  // K mayores de la parte
+            if (p_hi < p_lo) return;
+            for (uint64_t i = 0, n = (uint64_t)(p_hi - p_lo); i <= n; ++i) {  // sin desbordar en LLONG_MAX
+                const long long v = p_lo + (long long)i;
+                if (v > 5 && kWheelBit[v % 30] < 0) continue;  // múltiplo de 2, 3 o 5
+                if (!is_prime_u64((uint64_t)v)) continue;
+                ++pt.count;
+                if (pt.bottom.size() < K) pt.bottom.push_back(v);
+                last.push_back(v);
+                if (last.size() > K) last.pop_front();
+                if (want_list) pt.list.push_back(v);
+            }
+            pt.top.assign(last.rbegin(), last.rend());
+        });
+    for (auto& h : ths) h.join();
+
+    RangeResult res;
+    res.method = "mr";
+    for (auto& pt : parts) {
+        res.count += pt.count;
+        for (long long v : pt.bottom) if (res.bottom.size() < K) res.bottom.push_back(v);
+        res.list.insert(res.list.end(), pt.list.begin(), pt.list.end());
+    }
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it)
+        for (long long v : it->top) if (res.top.size() < K) res.top.push_back(v);
+    return res;
+}
+
+// Primos en [lo, hi]: cantidad, K menores, K mayores y (opcional) la lista completa
+static RangeResult primes_in_range(long long lo, long long hi, size_t K, bool want_list, int num_threads,
+                                   long long seg_bytes, RangeMethod method = RangeMethod::Auto) {
+    lo = max(lo, 0LL);
+    if (hi < lo) return RangeResult{};
+    // La criba trabaja con 30 * byte y m + 6p: deja margen para no desbordar
+    const bool sieve_ok = hi <= LLONG_MAX - (1LL << 36);
+    if (method == RangeMethod::Sieve && !sieve_ok) method = RangeMethod::MillerRabin;
+    if (method == RangeMethod::Auto) {
+        // ~100 operaciones por número con MR (1 de cada ~11 llega a las 7 bases)
+        // contra ~1 por número más sqrt(hi) con la criba
+        const long double W = (long double)hi - lo + 1;
+        method = !sieve_ok || 100 * W < sqrtl((long double)hi) + W ? RangeMethod::MillerRabin : RangeMethod::Sieve;
+    }
+    return method == RangeMethod::MillerRabin ? range_miller_rabin(lo, hi, K, want_list, num_threads)
+                                              : range_sieve(lo, hi, K, want_list, num_threads, seg_bytes);
+}
+
+static void print_list(const char* label, const vector<long long>& v) {
+    cout << label;
+    if (v.empty()) { cout << "(ninguno)\n"; return; }
+    for (size_t i = 0; i < v.size(); ++i) {
+        if (i) cout << ' ';
+        cout << v[i];
+    }
+    cout << "\n";
+}
+
 static void print_top10(const vector<long long>& v) {
     cout << "Top 10 primos (desc): ";
     if (v.empty()) { cout << "(ninguno)\n"; return; }
@@ -176,19 +945,76 @@ static void print_top10(const vector<long long>& v) {
     cout << "\n";
 }
 
+// Argumentos: posicionales (N, hilos) y opciones "--clave=valor" / "--clave"
+struct Args {
+    vector<string> pos;
+    map<string, string> opts;
+    bool has(const string& k) const { return opts.count(k) > 0; }
+    string get(const string& k, const string& def = "") const {
+        auto it = opts.find(k);
+        return it == opts.end() ? def : it->second;
+    }
+};
+
+static Args parse_args(int argc, char** argv) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        string s = argv[i];
+        if (s.rfind("--", 0) == 0) {
+            const size_t eq = s.find('=');
+            if (eq == string::npos) a.opts[s.substr(2)] = "";
+            else a.opts[s.substr(2, eq - 2)] = s.substr(eq + 1);
+        } else {
+            a.pos.push_back(s);
+        }
+    }
+    return a;
+}
+
+// Acepta "1000000000" y también "1e12". Todo el programa trabaja con long long:
+// un valor fuera de rango se rechaza en lugar de saturarlo o truncarlo en silencio.
+static long long parse_count(const string& s) {
+    bool ok = false;
+    long long v = 0;
+    if (s.find_first_of("eE.") != string::npos) {
+        try {
+            size_t pos = 0;
+            const long double x = stold(s, &pos);
+            // 2^63 es exacto en long double; el rango válido es [-2^63, 2^63)
+            ok = pos == s.size() && x >= -9223372036854775808.0L && x < 9223372036854775808.0L;
+            if (ok) v = (long long)x;
+        } catch (const exception&) {}
+    } else {
+        char* end = nullptr;
+        errno = 0;
+        v = strtoll(s.c_str(), &end, 10);
+        ok = errno != ERANGE && end != s.c_str() && *end == '\0';
+    }
+    if (!ok) {
+        cerr << "Valor inválido o fuera de rango (máximo " << LLONG_MAX << "): " << s << "\n";
+        exit(1);
+    }
+    return v;
+}
+
 int main(int argc, char** argv) {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
+    const Args args = parse_args(argc, argv);
     long long N = 0;
-    if (argc >= 2) {
-        N = atoll(argv[1]);
+    if (args.get("modo") == "rango" && args.pos.empty()) {
+        N = 2;  // el intervalo viene de --desde / --hasta
+    } else if (!args.pos.empty()) {
+        N = parse_count(args.pos[0]);
     } else {
         cout << "Ingrese N (>= 10000000): ";
-        if (!(cin >> N)) {
+        string line;
+        if (!(cin >> line)) {
             cerr << "Entrada inválida.\n";
             return 1;
         }
+        N = parse_count(line);
         string dummy; getline(cin, dummy);
     }
     if (N < 2) {
@@ -198,43 +1024,130 @@ int main(int argc, char** argv) {
 
     int hw = (int)thread::hardware_concurrency();
     if (hw <= 0) hw = 8;
-    int num_threads = (argc >= 3) ? stoi(argv[2]) : min(20, hw);
-
-    cout << "N=" << N << "  hilos=" << num_threads << "\n";
-
-    // -------- Secuencial --------
-    wait_enter("\nPresione ENTER para ejecutar la versión SECUENCIAL...");
-    auto t0 = Clock::now();
-    PrimeStats seq = primes_sequential(N);
-    auto t1 = Clock::now();
-    double ms_seq = chrono::duration_cast<ms>(t1 - t0).count();
-
-    cout << "\n[SECUENCIAL]\n";
-    cout << "Cantidad de primos < N: " << seq.count << "\n";
-    print_top10(seq.top10_desc);
-    cout << fixed << setprecision(3)
-         << "Tiempo secuencial: " << ms_seq/1000.0 << " s (" << ms_seq << " ms)\n";
-
-    // -------- Paralelo (intervalos variables + cola) --------
-    wait_enter("\nPresione ENTER para ejecutar la versión MULTIHILO (intervalos variables)...");
-    auto t2 = Clock::now();
-    PrimeStats par = primes_parallel_var(N, num_threads);
-    auto t3 = Clock::now();
-    double ms_par = chrono::duration_cast<ms>(t3 - t2).count();
-
-    cout << "\n[MULTIHILO]\n";
-    cout << "Cantidad de primos < N: " << par.count << "\n";
-    print_top10(par.top10_desc);
-    cout << fixed << setprecision(3)
-         << "Tiempo multihilo: " << ms_par/1000.0 << " s (" << ms_par << " ms)\n";
-
-    if (seq.count != par.count) {
-        cout << "ADVERTENCIA: difiere la cantidad (seq=" << seq.count
-             << ", par=" << par.count << ")\n";
-    }
-    if (ms_par > 0.0) {
-        double speedup = ms_seq / ms_par;
-        cout << "Speedup = " << speedup << "x\n";
+    int num_threads = (args.pos.size() >= 2) ? stoi(args.pos[1]) : min(20, hw);
+    const long long seg_bytes = args.has("segmento") ? atoll(args.get("segmento").c_str()) * 1024 : l1d_bytes();
+
+    // --planificador=estatico|ciclico|guiado|creciente|robo|todos
+    const string sched_arg = args.get("planificador", "creciente");
+    vector<SchedPolicy> policies;
+    if (sched_arg == "todos") {
+        policies = {SchedPolicy::StaticBlock, SchedPolicy::StaticCyclic, SchedPolicy::Guided,
+                    SchedPolicy::Growing, SchedPolicy::Stealing};
+    } else {
+        SchedPolicy p;
+        if (!parse_policy(sched_arg, p)) {
+            cerr << "Planificador desconocido: " << sched_arg
+                 << " (estatico, ciclico, guiado, creciente, robo o todos)\n";
+            return 1;
+        }
+        policies.push_back(p);
+    }
+
+    // --modo=contar: sólo pi(N) (Lucy_Hedgehog) y el top 10, sin cribar hasta N
+    if (args.get("modo") == "contar") {
+        cout << "N=" << N << "  hilos=" << num_threads << "  modo=contar (Lucy_Hedgehog)\n";
+        auto t0 = Clock::now();
+        PrimeStats st = primes_count_lucy(N, num_threads);
+        double ms_cnt = chrono::duration_cast<ms>(Clock::now() - t0).count();
+        cout << "Cantidad de primos < N: " << st.count << "\n";
+        print_top10(st.top10_desc);
+        cout << fixed << setprecision(3)
+             << "Tiempo conteo: " << ms_cnt/1000.0 << " s (" << ms_cnt << " ms)\n";
+        if (args.has("verificar")) {
+            auto t1 = Clock::now();
+            PrimeStats par = primes_parallel_var(N, num_threads, seg_bytes);
+            double ms_par = chrono::duration_cast<ms>(Clock::now() - t1).count();
+            cout << "Criba (verificación): " << par.count << " primos en " << ms_par << " ms -> "
+                 << (par.count == st.count && par.top10_desc == st.top10_desc ? "OK" : "DIFIERE") << "\n";
+            if (par.count != st.count || par.top10_desc != st.top10_desc) return 1;
+        }
+        return 0;
+    }
+
+    // --modo=rango --desde=lo --hasta=hi: primos en [lo, hi] (N no se usa)
+    if (args.get("modo") == "rango") {
+        const long long lo = parse_count(args.get("desde", "0"));
+        const long long hi = parse_count(args.get("hasta", to_string(N)));
+        const size_t K = (size_t)max(0LL, parse_count(args.get("k", "10")));
+        const string m = args.get("metodo", "auto");
+        RangeMethod method = m == "criba" ? RangeMethod::Sieve : m == "mr" ? RangeMethod::MillerRabin : RangeMethod::Auto;
+        if (m != "auto" && m != "criba" && m != "mr") {
+            cerr << "--metodo debe ser auto, criba o mr\n";
+            return 1;
+        }
+        const bool want_list = args.has("lista");
+        cout << "Intervalo [" << lo << ", " << hi << "]  ancho=" << max(0LL, hi - lo + 1)
+             << "  hilos=" << num_threads << "\n";
+        auto t0 = Clock::now();
+        RangeResult r = primes_in_range(lo, hi, K, want_list, num_threads, seg_bytes, method);
+        double ms_rng = chrono::duration_cast<ms>(Clock::now() - t0).count();
+        cout << "Método: " << (r.method.empty() ? "-" : r.method) << "\n";
+        cout << "Cantidad de primos en el intervalo: " << r.count << "\n";
+        print_list(("Menores " + to_string(K) + " (asc): ").c_str(), r.bottom);
+        print_list(("Mayores " + to_string(K) + " (desc): ").c_str(), r.top);
+        cout << fixed << setprecision(3)
+             << "Tiempo intervalo: " << ms_rng/1000.0 << " s (" << ms_rng << " ms)\n";
+        if (want_list) {
+            const string path = args.get("lista");
+            ofstream f;
+            if (!path.empty()) f.open(path);
+            ostream& out = path.empty() ? cout : f;
+            for (long long v : r.list) out << v << "\n";
+            if (!path.empty()) cout << r.list.size() << " primos escritos en " << path << "\n";
+        }
+        return 0;
+    }
+
+    // La versión secuencial guarda toda la criba (N/30 bytes): se saltea con
+    // --sin-secuencial o si no entra en la mitad de la memoria física.
+    const long double seq_bytes = (long double)wheel_bytes(N);
+    const long double phys = (long double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    const bool run_seq = !args.has("sin-secuencial") && (phys <= 0 || seq_bytes <= phys / 2);
+
+    cout << "N=" << N << "  hilos=" << num_threads << "  segmento=" << seg_bytes / 1024 << " KiB\n";
+    if (!run_seq && !args.has("sin-secuencial"))
+        cout << "(se omite la versión secuencial: necesitaría " << (double)(seq_bytes / (1 << 20)) << " MiB)\n";
+
+    double ms_seq = 0.0;
+    PrimeStats seq;
+    if (run_seq) {
+        // -------- Secuencial --------
+        wait_enter("\nPresione ENTER para ejecutar la versión SECUENCIAL...");
+        auto t0 = Clock::now();
+        seq = primes_sequential(N);
+        auto t1 = Clock::now();
+        ms_seq = chrono::duration_cast<ms>(t1 - t0).count();
+
+        cout << "\n[SECUENCIAL]\n";
+        cout << "Cantidad de primos < N: " << seq.count << "\n";
+        print_top10(seq.top10_desc);
+        cout << fixed << setprecision(3)
+             << "Tiempo secuencial: " << ms_seq/1000.0 << " s (" << ms_seq << " ms)\n";
+    }
+
+    // -------- Paralelo (una corrida por política) --------
+    for (SchedPolicy policy : policies) {
+        wait_enter(string("\nPresione ENTER para ejecutar la versión MULTIHILO (") + policy_name(policy) + ")...");
+        auto t2 = Clock::now();
+        PrimeStats par = primes_parallel_var(N, num_threads, seg_bytes, policy);
+        auto t3 = Clock::now();
+        double ms_par = chrono::duration_cast<ms>(t3 - t2).count();
+
+        cout << "\n[MULTIHILO - " << policy_name(policy) << "]\n";
+        cout << "Cantidad de primos < N: " << par.count << "\n";
+        print_top10(par.top10_desc);
+        cout << fixed << setprecision(3)
+             << "Tiempo multihilo: " << ms_par/1000.0 << " s (" << ms_par << " ms)\n";
+        print_sched_stats(g_sched_stats);
+
+        if (run_seq && seq.count != par.count) {
+            cout << "ADVERTENCIA: difiere la cantidad (seq=" << seq.count
+                 << ", par=" << par.count << ")\n";
+        }
+        if (run_seq && ms_par > 0.0) {
+            double speedup = ms_seq / ms_par;
+            cout << "Speedup = " << speedup << "x\n";
+        }
     }
 
     return 0;